@@ -14,6 +14,11 @@ void config_load(Config *cfg, const char *filename) {
     cfg->frame_dt_ms_busy = 60;
     cfg->show_intro = 1;
     cfg->debug_logs = 1;
+    cfg->planner = 0;
+    cfg->cooperative = 0;
+    cfg->coop_window = 8;
+    cfg->plan_threads = 1;
+    cfg->sim_speed = 1;
     FILE *f = fopen(filename, "r");
     if (!f) return;
     char line[128];
@@ -33,7 +38,26 @@ void config_load(Config *cfg, const char *filename) {
             else if (strstr(p, "frame_dt_ms_busy")) cfg->frame_dt_ms_busy = val;
             else if (strstr(p, "show_intro")) cfg->show_intro = val;
             else if (strstr(p, "debug_logs")) cfg->debug_logs = val;
+            else if (strstr(p, "planner")) cfg->planner = val;
+            else if (strstr(p, "cooperative")) cfg->cooperative = val;
+            else if (strstr(p, "coop_window")) cfg->coop_window = val;
+            else if (strstr(p, "plan_threads")) cfg->plan_threads = val;
+            else if (strstr(p, "sim_speed")) cfg->sim_speed = val;
         }
     }
     fclose(f);
 }
+
+void config_select_mode(Config *cfg, int mode) {
+    if (mode == 0) {
+        cfg->min_parking_time_sec = cfg->min_parking_time_smooth;
+        cfg->max_parking_time_sec = cfg->max_parking_time_smooth;
+        cfg->spawn_rate_ms = cfg->spawn_rate_smooth;
+        cfg->frame_dt_ms = cfg->frame_dt_ms_smooth;
+    } else {
+        cfg->min_parking_time_sec = cfg->min_parking_time_busy;
+        cfg->max_parking_time_sec = cfg->max_parking_time_busy;
+        cfg->spawn_rate_ms = cfg->spawn_rate_busy;
+        cfg->frame_dt_ms = cfg->frame_dt_ms_busy;
+    }
+}
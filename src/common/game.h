@@ -16,11 +16,20 @@ typedef struct {
     int frame_dt_ms; // selected mode
     int show_intro;
     int debug_logs;
+    int planner; // 0 = A*, 1 = Jump Point Search
+    int cooperative; // 0 = greedy mover, 1 = windowed cooperative A*
+    int coop_window; // reservation window in ticks
+    int plan_threads; // path planning threads per tick (1 = no workers)
+    int sim_speed; // simulated time per wall-clock time in the game (1 = real time)
 } Config;
 
 // Load config from file (simple key = value, ignores comments)
 void config_load(Config *cfg, const char *filename);
 
+// Copy the parking times, spawn rate and frame duration of a mode
+// (0 = Smooth, 1 = Busy) into the selected-mode fields
+void config_select_mode(Config *cfg, int mode);
+
 typedef struct {
     int account_balance;
 } Game;
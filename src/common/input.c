@@ -0,0 +1,52 @@
+#include "input.h"
+#include <stdbool.h>
+#include <termios.h>
+#include <unistd.h>
+
+static struct termios g_saved;
+static bool g_active = false;
+
+void input_begin(void)
+{
+    if (g_active || tcgetattr(STDIN_FILENO, &g_saved) != 0)
+        return;
+    struct termios raw = g_saved;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 0; // reads return at once, with or without a key
+    raw.c_cc[VTIME] = 0;
+    if (tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0)
+        g_active = true;
+}
+
+void input_end(void)
+{
+    if (!g_active)
+        return;
+    tcsetattr(STDIN_FILENO, TCSANOW, &g_saved);
+    g_active = false;
+}
+
+static int read_byte(void)
+{
+    unsigned char c;
+    return read(STDIN_FILENO, &c, 1) == 1 ? c : INPUT_NONE;
+}
+
+int input_poll(void)
+{
+    if (!g_active)
+        return INPUT_NONE;
+    int c = read_byte();
+    if (c != 27)
+        return c;
+    // Arrow keys arrive as "\033[A".."\033[D", all at once
+    if (read_byte() != '[')
+        return 27;
+    switch (read_byte()) {
+        case 'A': return INPUT_UP;
+        case 'B': return INPUT_DOWN;
+        case 'C': return INPUT_RIGHT;
+        case 'D': return INPUT_LEFT;
+        default: return INPUT_NONE;
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+// Keys besides plain chars returned by input_poll
+#define INPUT_NONE -1
+#define INPUT_UP 0x100
+#define INPUT_DOWN 0x101
+#define INPUT_LEFT 0x102
+#define INPUT_RIGHT 0x103
+
+// Read keys as they are typed, without echo, until input_end
+void input_begin(void);
+void input_end(void);
+
+// Next key typed, INPUT_NONE if there is none (does not block)
+int input_poll(void);
+
+#endif // INPUT_H
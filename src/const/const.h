@@ -1,8 +0,0 @@
-#ifndef CONSTANTS_H
-#define CONSTANTS_H
-
-#define MAP_WIDTH 151
-#define MAP_HEIGHT 30
-#define MAX_QUEUE (MAP_WIDTH * MAP_HEIGHT)
-
-#endif
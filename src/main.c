@@ -1,5 +1,8 @@
+#define _DEFAULT_SOURCE
 #include "common/debug.h"
 
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -9,95 +12,291 @@
 #include "common/menu.h"
 #include "common/logo.h"
 #include "common/menu.h"
+#include "common/input.h"
 #include "vehicle/vehicle.h"
-#include "vehicle/vehicle_list.h"
+#include "vehicle/vehicle_pool.h"
 #include "render/render.h"
+#include "render/snapshot.h"
+#include "sim/sim.h"
 #include "traffic/traffic.h"
-#include "common/direction.h"
+#include "path/path_cache.h"
 
 
 
-bool assets_init(Map *map)
+#include <stdint.h>
+
+// Wall clock in ms, for pacing only: simulated time is the Sim's clock
+static uint64_t wall_ms() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+// Set by 'q' or Ctrl-C: the simulation stops after the current tick
+static volatile sig_atomic_t g_quit = 0;
+
+static void on_interrupt(int sig)
 {
-    if (!map_load(map, "assets/map.txt"))
-    {
-        debug_log("Failed to load map\n");
-        return false;
+    (void)sig;
+    g_quit = 1;
+}
+
+// Simulated time per wall-clock time, changed with + and - (atomic)
+#define SPEED_MAX 64
+static int g_speed = 1;
+
+// Tiles the view scrolls per arrow key
+#define PAN_STEP_X 8
+#define PAN_STEP_Y 4
+
+// Render thread: draws the newest published snapshot, dropping the ones
+// it had no time for. The simulation never waits on the terminal.
+typedef struct
+{
+    Screen *screen;
+    const Map *map; // static layout only
+    SnapshotExchange *exchange;
+    int frame_dt_ms;
+    bool cooperative;
+    int running; // cleared by the simulation to stop (atomic)
+} RenderThread;
+
+static const char *vehicle_state_name(VehicleState state)
+{
+    switch (state) {
+        case VEH_DRIVING: return "Driving";
+        case VEH_PARKING: return "Parking";
+        case VEH_PARKED: return "Parked";
+        case VEH_LEAVING: return "Leaving";
+        case VEH_EXIT_QUEUE: return "ExitQueue";
+        default: return "Unknown";
     }
+}
 
-    if (!vehicle_sprites_init("assets/carSmall"))
-    {
-        debug_log("Failed to init vehicle sprites\n");
-        map_free(map);
-        return false;
+// Index of the followed vehicle in snap, -1 if none
+static int followed_index(const Screen *screen, const SimSnapshot *snap)
+{
+    for (int i = 0; screen->follow_slot >= 0 && i < snap->vehicle_count; ++i) {
+        const SnapVehicle *v = &snap->vehicles[i];
+        if (v->slot == screen->follow_slot && v->generation == screen->follow_generation)
+            return i;
     }
-    return true;
+    return -1;
 }
 
-// Add a field to Vehicle for real-time parking start (in ms since epoch)
-#include <stdint.h>
+// Arrow keys pan the view, f follows the next vehicle on the board, +/-
+// double or halve the speed, q quits. Returns true if a key was handled.
+static bool render_handle_keys(Screen *screen, const SimSnapshot *snap)
+{
+    bool handled = false;
+    for (int key; (key = input_poll()) != INPUT_NONE;) {
+        handled = true;
+        switch (key) {
+            case INPUT_UP: screen_pan(screen, 0, -PAN_STEP_Y); break;
+            case INPUT_DOWN: screen_pan(screen, 0, PAN_STEP_Y); break;
+            case INPUT_LEFT: screen_pan(screen, -PAN_STEP_X, 0); break;
+            case INPUT_RIGHT: screen_pan(screen, PAN_STEP_X, 0); break;
+            case 'f':
+                if (snap && snap->vehicle_count > 0) {
+                    const SnapVehicle *v = &snap->vehicles[(followed_index(screen, snap) + 1) % snap->vehicle_count];
+                    screen_follow(screen, v->slot, v->generation);
+                }
+                break;
+            case '+':
+            case '=': {
+                int speed = __atomic_load_n(&g_speed, __ATOMIC_RELAXED);
+                __atomic_store_n(&g_speed, speed < SPEED_MAX ? speed * 2 : speed, __ATOMIC_RELAXED);
+                break;
+            }
+            case '-': {
+                int speed = __atomic_load_n(&g_speed, __ATOMIC_RELAXED);
+                __atomic_store_n(&g_speed, speed > 1 ? speed / 2 : speed, __ATOMIC_RELAXED);
+                break;
+            }
+            case 'q': g_quit = 1; break;
+            default: handled = false; break;
+        }
+    }
+    return handled;
+}
 
-// Helper to get current time in ms
-static uint64_t now_ms() {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+static void *render_main(void *arg)
+{
+    RenderThread *rt = arg;
+    Screen *screen = rt->screen;
+    unsigned long drawn_seq = 0;
+    unsigned long frames = 0;
+    unsigned long long render_bytes = 0; // written by screen_present so far
+    while (__atomic_load_n(&rt->running, __ATOMIC_ACQUIRE)) {
+        const SimSnapshot *snap = snapshot_latest(rt->exchange);
+        bool keys = render_handle_keys(screen, snap);
+        if (!snap || (snap->seq == drawn_seq && !keys)) {
+            usleep(rt->frame_dt_ms * 125); // a quarter of a simulation tick
+            continue;
+        }
+        drawn_seq = snap->seq;
+
+        // 1) Paths and vehicles onto the static background
+        screen_update(screen, snap);
+
+        // 2) Present
+        screen_present(screen, rt->map, snap);
+
+        frames++;
+        render_bytes += screen->frame_bytes;
+        int followed = followed_index(screen, snap);
+        printf("View: x %d-%d, y %d-%d of %dx%d",
+               screen->view_x, screen->view_x + screen->view_w - 1,
+               screen->view_y, screen->view_y + screen->view_h - 1, screen->width, screen->height);
+        if (followed >= 0)
+            printf(", following vehicle %d", followed);
+        printf(", speed %dx (arrows pan, f follows, +/- speed, q quits)\n",
+               __atomic_load_n(&g_speed, __ATOMIC_RELAXED));
+        printf("Account Balance: \033[92m%d\033[0m\n", snap->account_balance);
+        printf("Render: %zu bytes this frame, %.0f on average\n",
+               screen->frame_bytes, (double)render_bytes / frames);
+        printf("Path cache: %lu hits / %lu misses\n", snap->cache_hits, snap->cache_misses);
+        const TrafficStats *ts = &snap->traffic;
+        printf("Traffic (%s): %lu blocked vehicle-ticks, %lu exited, %.2f cars / 100 ticks\n",
+               rt->cooperative ? "cooperative" : "greedy", ts->blocked, ts->exited,
+               ts->ticks ? ts->exited * 100.0 / ts->ticks : 0.0);
+
+        // --- Stat Board ---
+        printf("\n=== Vehicle Overview ===\n");
+        printf("%-10s %-12s %-15s %-15s\n", "VehicleID", "State", "ParkingTime (s)", "Remaining (s)");
+        int live_count = snap->vehicle_count;
+        // 8 lines of stats above, and the last line stays free so the
+        // final newline does not scroll the map
+        int board_rows = screen_lines_below(screen) - 9;
+        for (int vid = 0; vid < live_count; ++vid) {
+            if (vid >= board_rows - 1 && live_count > board_rows) {
+                if (board_rows > 0)
+                    printf("... %d more\n", live_count - vid);
+                break;
+            }
+            const SnapVehicle *v = &snap->vehicles[vid];
+            printf("%-10d %-12s %-15d %-15d\n", vid, vehicle_state_name(v->state),
+                   v->parking_time_sec, v->remaining_sec);
+        }
+        fflush(stdout);
+    }
+    return NULL;
+}
+
+// Print what a run achieved, per simulated hour where it makes sense
+static void print_kpis(const Sim *sim, uint64_t sim_ms, unsigned long skipped, uint64_t wall_ms)
+{
+    double hours = sim_ms / 3600000.0;
+    const TrafficStats *ts = traffic_get_stats();
+    const SimStats *st = &sim->stats;
+    int spots = sim->map.parking_count;
+    printf("Simulated %.2f h (%lu ticks, %lu skipped idle) in %.2f s",
+           hours, st->ticks, skipped, wall_ms / 1000.0);
+    if (wall_ms > 0)
+        printf(", %.0fx real time", (double)sim_ms / wall_ms);
+    printf("\n");
+    printf("Throughput: %lu spawned, %lu exited, %.1f exits / h\n",
+           st->spawned, ts->exited, hours > 0 ? ts->exited / hours : 0.0);
+    printf("Occupancy: %.1f %% average, %d of %d spots at peak\n",
+           spots && st->ticks ? 100.0 * st->parked_spot_ticks / ((double)st->ticks * spots) : 0.0,
+           st->peak_parked, spots);
+    printf("Revenue: %d total, %.1f / h\n",
+           sim->game.account_balance, hours > 0 ? sim->game.account_balance / hours : 0.0);
+    printf("Traffic (%s): %lu blocked vehicle-ticks\n",
+           sim->config.cooperative ? "cooperative" : "greedy", ts->blocked);
+}
+
+// Run `hours` of simulated time as fast as possible: no logo, menu,
+// terminal output, sound or sleeping, and idle stretches skipped
+static int run_headless(const Config *config, double hours)
+{
+    Sim sim;
+    if (!sim_init(&sim, config, false))
+        return 1;
+    signal(SIGINT, on_interrupt);
+    uint64_t end_ms = (uint64_t)(hours * 3600000.0);
+    unsigned long skipped = 0;
+    uint64_t start = wall_ms();
+    while (sim.now_ms < end_ms && !g_quit) {
+        sim_tick(&sim);
+        skipped += sim_skip_idle(&sim, end_ms);
+    }
+    print_kpis(&sim, sim.now_ms, skipped, wall_ms() - start);
+    sim_free(&sim);
+    return 0;
 }
 
-int main(void)
+static void usage(const char *prog)
 {
+    fprintf(stderr, "Usage: %s [--config FILE] [--headless [--mode smooth|busy] [--hours N] [--seed N]]\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+    const char *config_path = "assets/config.txt";
+    bool headless = false;
+    int mode = 0; // 0 = Smooth, 1 = Busy
+    double hours = 1.0;
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--headless") == 0) {
+            headless = true;
+        } else if (strcmp(arg, "--config") == 0 && val) {
+            config_path = val;
+            i++;
+        } else if (strcmp(arg, "--mode") == 0 && val && (strcmp(val, "smooth") == 0 || strcmp(val, "busy") == 0)) {
+            mode = strcmp(val, "busy") == 0;
+            i++;
+        } else if (strcmp(arg, "--hours") == 0 && val && atof(val) > 0) {
+            hours = atof(val);
+            i++;
+        } else if (strcmp(arg, "--seed") == 0 && val) {
+            srand((unsigned)strtoul(val, NULL, 10));
+            i++;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
     Config config;
-    config_load(&config, "assets/config.txt");
+    config_load(&config, config_path);
+    if (headless) {
+        config_select_mode(&config, mode);
+        debug_set_enabled(config.debug_logs);
+        return run_headless(&config, hours);
+    }
+
     // Show animated logo before menu if enabled
     if (config.show_intro) {
         show_logo_animated();
     }
-    int mode = menu_show(); // 0 = Smooth, 1 = Busy
+    mode = menu_show();
     // Set selected mode's parking times, spawn rate, and frame duration
-    if (mode == 0) {
-        config.min_parking_time_sec = config.min_parking_time_smooth;
-        config.max_parking_time_sec = config.max_parking_time_smooth;
-        config.spawn_rate_ms = config.spawn_rate_smooth;
-        config.frame_dt_ms = config.frame_dt_ms_smooth;
-    } else {
-        config.min_parking_time_sec = config.min_parking_time_busy;
-        config.max_parking_time_sec = config.max_parking_time_busy;
-        config.spawn_rate_ms = config.spawn_rate_busy;
-        config.frame_dt_ms = config.frame_dt_ms_busy;
-    }
+    config_select_mode(&config, mode);
     debug_set_enabled(config.debug_logs);
 
     // Start looping street ambience sound
     system("play -q assets/sounds/street_ambience.mp3 repeat 9999 > /dev/null 2>&1 &");
-    Map map;
-    if (!assets_init(&map))
+    Sim sim;
+    if (!sim_init(&sim, &config, true))
         return 1;
 
     Screen screen;
-    if (!screen_init(&screen, &map))
+    if (!screen_init(&screen, &sim.map))
     {
         debug_log("Failed to init screen\n");
-        map_free(&map);
+        sim_free(&sim);
+        return 1;
+    }
+    if (!screen_from_map(&screen, &sim.map))
+    {
+        debug_log("Failed to init screen\n");
+        screen_free(&screen);
+        sim_free(&sim);
         return 1;
     }
-
-    VehicleList vehicles;
-    vehicle_list_init(&vehicles);
-
-    Game game = {0};
-    game.account_balance = 0;
-
-    const int FRAME_DT_MS = config.frame_dt_ms;
-    enum Phase { PHASE_SPAWN, PHASE_WAIT_OPEN, PHASE_OPEN, PHASE_WAIT_CLOSE, PHASE_WAIT_SPAWN };
-    enum Phase phase = PHASE_SPAWN;
-    int phase_timer = 0;
-    int vehicle_steps = 0;
-    int last_vehicle_x = -1, last_vehicle_y = -1;
-    int total_steps = 0;
-    int vehicle_id = 0;
-
-    // Ensure gate is closed at start
-    map_set_gate_open(&map, 0);
 
     if (config.show_intro) {
         FILE *logo = fopen("assets/logo.txt", "r");
@@ -109,260 +308,64 @@ int main(void)
         }
     }
 
-    int step = 0;
-    while(1) {
-        step++;
-        // State machine for gate/vehicle logic
-        switch (phase) {
-            case PHASE_SPAWN: {
-                // Spawn a new vehicle at start
-                Vehicle v;
-                int vx = 133, vy = 27;
-                if (map.has_start) {
-                    vx = map.start_x;
-                    vy = map.start_y;
-                }
-                vehicle_init(&v, vx, vy, DIR_WEST);
-                vehicle_list_push_back(&vehicles, &v);
-                Vehicle *nv = &vehicles.tail->vehicle;
-                traffic_init_vehicle_route(nv, &map);
-                vehicle_steps = 0;
-                last_vehicle_x = vx;
-                last_vehicle_y = vy;
-                phase_timer = config.spawn_rate_ms; // Use mode-specific spawn rate
-                phase = PHASE_WAIT_OPEN;
-                break;
-            }
-            case PHASE_WAIT_OPEN:
-                phase_timer -= FRAME_DT_MS;
-                if (phase_timer <= 0) {
-                    map_set_gate_open(&map, 1); // open gate
-                    // Replan path for the most recent vehicle if not parking and has no path
-                    VehicleNode *last = vehicles.tail;
-                    if (last && !last->vehicle.going_to_parking && !last->vehicle.has_path) {
-                        traffic_init_vehicle_route(&last->vehicle, &map);
-                    }
-                    phase = PHASE_OPEN;
-                }
-                break;
-            case PHASE_OPEN: {
-                // Count steps for the most recent vehicle
-                VehicleNode *last = vehicles.tail;
-                if (last) {
-                    // Only count steps if vehicle actually moves
-                    if (last->vehicle.x != last_vehicle_x || last->vehicle.y != last_vehicle_y) {
-                        vehicle_steps++;
-                        last_vehicle_x = last->vehicle.x;
-                        last_vehicle_y = last->vehicle.y;
-                    }
-                    int steps_needed = last->vehicle.sprites->east.width + 2;
-                    if (vehicle_steps >= steps_needed) {
-                        map_set_gate_open(&map, 0); // close gate
-                        phase_timer = 1000; // 1 second
-                        phase = PHASE_WAIT_CLOSE;
-                    }
-                }
-                break;
-            }
-            case PHASE_WAIT_CLOSE:
-                phase_timer -= FRAME_DT_MS / 2; // match tick speed
-                if (phase_timer <= 0) {
-                    phase = PHASE_WAIT_SPAWN;
-                    phase_timer = 1000; // 1 second wait before next spawn
-                }
-                break;
-            case PHASE_WAIT_SPAWN:
-                phase_timer -= FRAME_DT_MS / 2;
-                if (phase_timer <= 0) {
-                    phase = PHASE_SPAWN;
-                }
-                break;
-        }
-
-        // 1) Static background
-        screen_from_map(&screen, &map);
-        screen_draw_paths(&screen, &vehicles);
-        // 2) Vehicles
-        for (VehicleNode *node = vehicles.head; node != NULL; node = node->next)
-            screen_draw_vehicle(&screen, &node->vehicle, &map);
+    // The simulation runs on this thread and hands frames to the renderer
+    SnapshotExchange exchange;
+    snapshot_exchange_init(&exchange);
+    RenderThread render = {&screen, &sim.map, &exchange, config.frame_dt_ms, config.cooperative != 0, 1};
+    // Both are set up before the render thread, which reads and changes them
+    g_speed = config.sim_speed < 1 ? 1 : config.sim_speed > SPEED_MAX ? SPEED_MAX : config.sim_speed;
+    input_begin();
+    pthread_t render_thread;
+    if (pthread_create(&render_thread, NULL, render_main, &render) != 0)
+    {
+        debug_log("Failed to start render thread\n");
+        input_end();
+        snapshot_exchange_free(&exchange);
+        screen_free(&screen);
+        sim_free(&sim);
+        return 1;
+    }
+    signal(SIGINT, on_interrupt);
 
-        // 3) Present
-        screen_present(&screen, &map, step);
+    // Pacing: simulated time since the anchor runs `speed` times as fast as
+    // the wall clock. Re-anchored when the speed changes or the simulation
+    // falls behind, rather than rushing to catch up.
+    int speed = 0;
+    uint64_t wall_anchor = 0, sim_anchor = 0;
+    while (!g_quit) {
+        sim_tick(&sim);
 
-        printf("Account Balance: \033[92m%d\033[0m\n", game.account_balance);
-        // --- Stat Board ---
-        printf("\n=== Vehicle Overview ===\n");
-        printf("%-10s %-12s %-15s %-15s\n", "VehicleID", "State", "ParkingTime (s)", "Remaining (s)");
-        int vid = 0;
-        for (VehicleNode *node = vehicles.head; node != NULL; node = node->next, ++vid) {
-            Vehicle *v = &node->vehicle;
-            // Assign parking time and set real start time
-            if (v->state == VEH_PARKED) {
-                if (v->parking_time_sec == 0) {
-                    int min_sec = config.min_parking_time_sec;
-                    int max_sec = config.max_parking_time_sec;
-                    if (max_sec < min_sec) max_sec = min_sec;
-                    v->parking_time_sec = min_sec + rand() % (max_sec - min_sec + 1);
-                    v->parking_start_time_ms = now_ms();
-                    debug_log("[DEBUG] Vehicle %d: Assigned random parking time: %d s, start_time_ms: %llu\n", vid, v->parking_time_sec, (unsigned long long)v->parking_start_time_ms);
-                }
-                uint64_t elapsed_ms = now_ms() - v->parking_start_time_ms;
-                int remaining_ms = v->parking_time_sec * 1000 - (int)elapsed_ms;
-                if (remaining_ms < 0) remaining_ms = 0;
-                v->parking_time_remaining = remaining_ms;
-                if (v->parking_time_remaining <= 0) {
-                    debug_log("[DEBUG] Vehicle %d: Parking time elapsed, switching to LEAVING.\n", vid);
-                    v->state = VEH_LEAVING;
-                    const Sprite *spr = vehicle_get_sprite(v);
-                    v->reverse_steps_remaining = spr->width + 2; // Back out 2 extra tiles for testing
-                    debug_log("[DEBUG] Vehicle %d: Starting to reverse out (%d steps)\n", vid, v->reverse_steps_remaining);
-                }
-            } else {
-                // Reset for next time parked
-                v->parking_time_sec = (v->state == VEH_LEAVING || v->state == VEH_EXIT_QUEUE || v->state == VEH_DRIVING) ? v->parking_time_sec : 0;
-            }
-            const char *state_str = "";
-            switch (v->state) {
-                case VEH_DRIVING: state_str = "Driving"; break;
-                case VEH_PARKING: state_str = "Parking"; break;
-                case VEH_PARKED: state_str = "Parked"; break;
-                case VEH_LEAVING: state_str = "Leaving"; break;
-                case VEH_EXIT_QUEUE: state_str = "ExitQueue"; break;
-                default: state_str = "Unknown"; break;
-            }
-            int remaining_sec = (v->state == VEH_PARKED) ? (v->parking_time_remaining + 999) / 1000 : 0;
-            printf("%-10d %-12s %-15d %-15d\n", vid, state_str, v->parking_time_sec, remaining_sec);
+        // Hand this tick's result to the render thread
+        SimSnapshot *snap = snapshot_back(&exchange);
+        if (snapshot_capture(snap, &sim.map, &sim.vehicles, sim.now_ms)) {
+            snap->step = sim.step;
+            snap->account_balance = sim.game.account_balance;
+            path_cache_stats(&snap->cache_hits, &snap->cache_misses);
+            snap->traffic = *traffic_get_stats();
+            snapshot_publish(&exchange);
         }
-        // --- Back out logic for VEH_LEAVING ---
-        for (VehicleNode *node = vehicles.head; node != NULL; node = node->next) {
-            Vehicle *v = &node->vehicle;
-            // When vehicle reaches (0,1), close the gate again
-            if (v->state == VEH_DRIVING && v->x == 0 && v->y == 1) {
-                if (map.gate_exit.open) {
-                    map.gate_exit.open = 0;
-                    debug_log("[DEBUG] Exit gate closed after vehicle reached (0,1).\n");
-                }
-                // Add money to account based on parking_time_sec and mark for deletion
-                int payout = v->parking_time_sec * 10;
-                game.account_balance += payout;
-                system("play assets/sounds/money_count.mp3 > /dev/null 2>&1 &");
-                debug_log("[DEBUG] Vehicle at (0,1) exited. +%d to account for %d seconds parked. Marking for removal.\n", payout, v->parking_time_sec);
-                v->state = -1; // Mark for deletion
-            }
-            // Handle exit gate opening for single vehicle
-            // Transition to exit queue and immediately assign path if vehicle reaches 'E' tile (exit entry spot)
-            if ((v->state == VEH_DRIVING || v->state == VEH_EXIT_QUEUE) && map.has_end && v->x == map.end_x && v->y == map.end_y) {
-                if (!map.gate_exit.open) {
-                    map.gate_exit.open = 1;
-                    debug_log("[DEBUG] Exit gate opened for vehicle %d.\n", vid);
-                }
-                v->state = VEH_EXIT_QUEUE;
-                v->has_path = 0;
-                debug_log("[DEBUG] Vehicle %d: Reached exit entry spot ('E'), now in exit queue.\n", vid);
-                // Set path goal to (0,1)
-                int target_x = 0, target_y = 1;
-                const Sprite *spr = vehicle_get_sprite(v);
-                debug_log("[DEBUG] Car sprite width: %d, height: %d\n", spr ? spr->width : -1, spr ? spr->height : -1);
-                Path p; path_init(&p);
-                int found = path_find(&map, v->x, v->y, target_x, target_y, &p);
-                debug_log("[DEBUG] path_find to (%d,%d) returned %d, path length: %d\n", target_x, target_y, found, p.length);
-                if (found) {
-                    vehicle_set_path(v, &p);
-                    v->state = VEH_DRIVING;
-                    debug_log("[DEBUG] Vehicle %d: Path to (%d,%d) set, now driving to exit (0,1).\n", vid, target_x, target_y);
-                } else {
-                    debug_log("[DEBUG] Vehicle %d: Failed to set path to (%d,%d)!\n", vid, target_x, target_y);
-                }
-            }
-            // When vehicle reaches (0,1), close the gate again
-            if (v->state == VEH_DRIVING && v->x == 0 && v->y == 1) {
-                if (map.gate_exit.open) {
-                    map.gate_exit.open = 0;
-                    debug_log("[DEBUG] Exit gate closed after vehicle reached (0,1).\n");
-                }
-            }
-            if (v->state == VEH_LEAVING && v->reverse_steps_remaining > 0) {
-                debug_log("[DEBUG] Vehicle at (%d,%d) in LEAVING, reverse_steps_remaining=%d\n", v->x, v->y, v->reverse_steps_remaining);
-                // Move in the opposite direction of v->dir
-                switch (v->dir) {
-                    case DIR_EAST:  v->x -= 1; break;
-                    case DIR_WEST:  v->x += 1; break;
-                    case DIR_NORTH: v->y += 1; break;
-                    case DIR_SOUTH: v->y -= 1; break;
-                }
-                v->reverse_steps_remaining--;
-                debug_log("[DEBUG] Vehicle: Reversing, steps remaining: %d\n", v->reverse_steps_remaining);
-                // Only clear parking assignment after reversing is done
-                if (v->reverse_steps_remaining == 0) {
-                    // Only clear parking assignment once
-                    if (v->assigned_spot) {
-                        debug_log("[DEBUG] Vehicle: Finished reversing, clearing parking spot and searching for exit tile...\n");
-                        ParkingSpot *spot = v->assigned_spot;
-                        spot->occupied = 0;
-                        spot->occupant = NULL;
-                        v->assigned_spot = NULL;
-                        v->parking_spot_id = -1;
-                    }
-                    // Always try to plan path to exit if not already driving
-                    if (v->state == VEH_LEAVING) {
-                        if (map.has_end) {
-                            int ex = map.end_x;
-                            int ey = map.end_y;
-                            const Sprite *spr = vehicle_get_sprite(v);
-                            int car_w = spr->width;
-                            int car_h = spr->height;
-                            debug_log("[DEBUG] Attempting to pathfind_with_size from (%d, %d) to exit (%d, %d) with car size %dx%d\n", v->x, v->y, ex, ey, car_w, car_h);
-                            if (!map_is_walkable(&map, v->x, v->y)) {
-                                debug_log("[DEBUG] Vehicle at (%d,%d) is not on a walkable tile! Tile type: %d\n", v->x, v->y, map.tiles[v->y][v->x].type);
-                            }
-                            if (!map_is_walkable(&map, ex, ey)) {
-                                debug_log("[DEBUG] Exit tile at (%d,%d) is not walkable! Tile type: %d\n", ex, ey, map.tiles[ey][ex].type);
-                            }
-                            Path p; path_init(&p);
-                            int found = path_find_with_size(&map, v->x, v->y, ex, ey, car_w, car_h, &p);
-                            debug_log("[DEBUG] path_find_with_size returned %d, path length: %d\n", found, p.length);
-                            if (found) {
-                                vehicle_set_path(v, &p);
-                                v->state = VEH_DRIVING;
-                                debug_log("[DEBUG] Path to exit set, vehicle now driving to exit. State: %d, has_path: %d\n", v->state, v->has_path);
-                            } else {
-                                debug_log("[DEBUG] Pathfinding to exit failed! Will retry next frame.\n");
-                            }
-                        } else {
-                            debug_log("[DEBUG] No exit tile found: map.has_end is not set!\n");
-                        }
-                    }
-                }
-            }
+
+        int new_speed = __atomic_load_n(&g_speed, __ATOMIC_RELAXED);
+        uint64_t wall = wall_ms();
+        uint64_t due = wall_anchor + (sim.now_ms - sim_anchor) / (speed ? speed : 1);
+        if (new_speed != speed || wall > due + sim.tick_ms) {
+            speed = new_speed;
+            wall_anchor = wall;
+            sim_anchor = sim.now_ms;
+            due = wall + sim.tick_ms / speed;
         }
-        // 4) One traffic simulation step (move + path replanning)
-        traffic_step(&vehicles, &map);
-        usleep(FRAME_DT_MS * 500); // double speed for debugging
-        total_steps++;
-            // Remove vehicles marked for deletion
-            VehicleNode *prev = NULL;
-            VehicleNode *node = vehicles.head;
-            while (node) {
-                Vehicle *v = &node->vehicle;
-                VehicleNode *next = node->next;
-                if (v->state == -1) {
-                    if (prev) prev->next = next;
-                    else vehicles.head = next;
-                    if (vehicles.tail == node) vehicles.tail = prev;
-                    free(node);
-                    node = next;
-                    continue;
-                }
-                prev = node;
-                node = next;
-            }
+        if (due > wall)
+            usleep((due - wall) * 1000);
     }
 
-    vehicle_list_clear(&vehicles);
+    __atomic_store_n(&render.running, 0, __ATOMIC_RELEASE);
+    pthread_join(render_thread, NULL);
+    snapshot_exchange_free(&exchange);
+    input_end();
     screen_free(&screen);
-    map_free(&map);
+    sim_free(&sim);
 
     // Stop sound
     system("pkill play");
     return 0;
-}
\ No newline at end of file
+}
@@ -7,9 +7,44 @@
 #include "map.h"
 #include "waypoint.h"
 
+static void map_refresh_footprints_near_gate(Map *map, const Gate *gate);
+static void map_set_gate_bits(Map *map, const Gate *gate);
+static bool map_build_walk_bits(Map *map);
+static bool map_build_spot_index(Map *map);
+
 void map_set_gate_open(Map *map, int open) {
     assert(map);
-    map->gate_entry.open = open ? 1 : 0;
+    open = open ? 1 : 0;
+    if (map->gate_entry.open == open)
+        return;
+    map->gate_entry.open = open;
+    map_set_gate_bits(map, &map->gate_entry);
+    map->walk_epoch++;
+    map_refresh_footprints_near_gate(map, &map->gate_entry);
+}
+
+void map_set_exit_gate_open(Map *map, int open) {
+    assert(map);
+    open = open ? 1 : 0;
+    if (map->gate_exit.open == open)
+        return;
+    map->gate_exit.open = open;
+    map_set_gate_bits(map, &map->gate_exit);
+    map->walk_epoch++;
+    map_refresh_footprints_near_gate(map, &map->gate_exit);
+}
+
+const MapChange *map_get_change(const Map *map, unsigned int epoch) {
+    assert(map);
+    const MapChange *change = &map->changes[epoch % MAP_CHANGE_LOG];
+    if (epoch == 0 || change->epoch != epoch)
+        return NULL;
+    return change;
+}
+
+unsigned int map_walk_key(const Map *map) {
+    assert(map);
+    return (unsigned int)map->gate_entry.open | ((unsigned int)map->gate_exit.open << 1);
 }
 
 int map_get_gate_open(const Map *map) {
@@ -37,6 +72,14 @@ bool map_load(Map *map, const char *filename)
     map->has_end = 0;
     map->end_x = -1;
     map->end_y = -1;
+    map->footprint_count = 0;
+    map->walk_epoch = 0;
+    map->walk_words = 0;
+    map->walk_bits = NULL;
+    map->gate_bits = NULL;
+    map->spot_buckets = NULL;
+    for (int i = 0; i < MAP_CHANGE_LOG; ++i)
+        map->changes[i] = (MapChange){0, 0, 0, -1, -1};
     FILE *f = fopen(filename, "r");
     if (!f)
     {
@@ -191,6 +234,15 @@ bool map_load(Map *map, const char *filename)
 
     map_build_parking_spots(map);
 
+    if (!map_build_walk_bits(map) || !map_build_spot_index(map))
+    {
+        debug_log("Failed to allocate walkability bitmaps or spot index\n");
+        map_free(map);
+        for (int i = 0; i < num_lines; ++i)
+            free(lines[i]);
+        return false;
+    }
+
     // Free temporary lines
     for (int i = 0; i < num_lines; ++i)
     {
@@ -301,11 +353,112 @@ const ParkingSpot *map_get_parking_spot_with_indicator(const Map *map, int x, in
     return NULL;
 }
 
+// Bucket every spot into the grid cells its block overlaps; all start free
+static bool map_build_spot_index(Map *map)
+{
+    map->bucket_cols = (map->width + SPOT_BUCKET_SIZE - 1) / SPOT_BUCKET_SIZE;
+    map->bucket_rows = (map->height + SPOT_BUCKET_SIZE - 1) / SPOT_BUCKET_SIZE;
+    size_t words = (size_t)map->bucket_cols * map->bucket_rows * SPOT_MASK_WORDS;
+    map->spot_buckets = calloc(words ? words : 1, sizeof(uint64_t));
+    if (!map->spot_buckets)
+        return false;
+
+    for (int w = 0; w < SPOT_MASK_WORDS; ++w)
+        map->spot_free[w] = 0;
+    map->free_spot_count = 0;
+    for (int i = 0; i < map->parking_count; ++i)
+    {
+        const ParkingSpot *s = &map->parkings[i];
+        uint64_t bit = (uint64_t)1 << (i & 63);
+        for (int by = s->y0 / SPOT_BUCKET_SIZE; by <= (s->y0 + s->height - 1) / SPOT_BUCKET_SIZE; ++by)
+            for (int bx = s->x0 / SPOT_BUCKET_SIZE; bx <= (s->x0 + s->width - 1) / SPOT_BUCKET_SIZE; ++bx)
+                map->spot_buckets[(by * map->bucket_cols + bx) * SPOT_MASK_WORDS + (i >> 6)] |= bit;
+        if (!s->occupied)
+        {
+            map->spot_free[i >> 6] |= bit;
+            map->free_spot_count++;
+        }
+    }
+    return true;
+}
+
+void map_occupy_spot(Map *map, ParkingSpot *spot, Vehicle *v)
+{
+    uint64_t bit = (uint64_t)1 << (spot->id & 63);
+    if (map->spot_free[spot->id >> 6] & bit)
+    {
+        map->spot_free[spot->id >> 6] &= ~bit;
+        map->free_spot_count--;
+    }
+    spot->occupied = 1;
+    spot->occupant = v;
+}
+
+void map_release_spot(Map *map, ParkingSpot *spot)
+{
+    uint64_t bit = (uint64_t)1 << (spot->id & 63);
+    if (!(map->spot_free[spot->id >> 6] & bit))
+    {
+        map->spot_free[spot->id >> 6] |= bit;
+        map->free_spot_count++;
+    }
+    spot->occupied = 0;
+    spot->occupant = NULL;
+}
+
+int map_free_spots_near(const Map *map, int x0, int y0, int x1, int y1,
+                        uint64_t mask[SPOT_MASK_WORDS])
+{
+    for (int w = 0; w < SPOT_MASK_WORDS; ++w)
+        mask[w] = 0;
+    if (map->free_spot_count == 0)
+        return 0;
+
+    // Clamp to the map; spots never lie outside it
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 >= map->width) x1 = map->width - 1;
+    if (y1 >= map->height) y1 = map->height - 1;
+    if (x0 > x1 || y0 > y1)
+        return 0;
+
+    for (int by = y0 / SPOT_BUCKET_SIZE; by <= y1 / SPOT_BUCKET_SIZE; ++by)
+    {
+        const uint64_t *row = &map->spot_buckets[by * map->bucket_cols * SPOT_MASK_WORDS];
+        for (int bx = x0 / SPOT_BUCKET_SIZE; bx <= x1 / SPOT_BUCKET_SIZE; ++bx)
+            for (int w = 0; w < SPOT_MASK_WORDS; ++w)
+                mask[w] |= row[bx * SPOT_MASK_WORDS + w];
+    }
+
+    int count = 0;
+    for (int w = 0; w < SPOT_MASK_WORDS; ++w)
+    {
+        mask[w] &= map->spot_free[w];
+        count += __builtin_popcountll(mask[w]);
+    }
+    return count;
+}
+
 void map_free(Map *map)
 {
     if (!map || !map->tiles)
         return;
 
+    for (int i = 0; i < map->footprint_count; ++i)
+    {
+        free(map->footprints[i].fits);
+        map->footprints[i].fits = NULL;
+    }
+    map->footprint_count = 0;
+
+    free(map->walk_bits);
+    free(map->gate_bits);
+    map->walk_bits = NULL;
+    map->gate_bits = NULL;
+    map->walk_words = 0;
+    free(map->spot_buckets);
+    map->spot_buckets = NULL;
+
     for (int y = 0; y < map->height; ++y)
     {
         free(map->tiles[y]);
@@ -322,30 +475,200 @@ bool map_in_bounds(const Map *map, int x, int y)
            y >= 0 && y < map->height;
 }
 
+// Set or clear a gate's tiles in the closed-gate overlay
+static void map_set_gate_bits(Map *map, const Gate *gate)
+{
+    if (!map->gate_bits)
+        return;
+    for (int ti = 0; ti < gate->tile_count; ++ti)
+    {
+        int x = gate->xs[ti];
+        int y = gate->ys[ti];
+        if (!map_in_bounds(map, x, y))
+            continue;
+        uint64_t bit = (uint64_t)1 << (x & 63);
+        uint64_t *word = &map->gate_bits[y * map->walk_words + (x >> 6)];
+        if (gate->open)
+            *word &= ~bit;
+        else
+            *word |= bit;
+    }
+}
+
+static bool map_build_walk_bits(Map *map)
+{
+    map->walk_words = (map->width + 63) / 64;
+    size_t words = (size_t)map->walk_words * map->height;
+    map->walk_bits = calloc(words ? words : 1, sizeof(uint64_t));
+    map->gate_bits = calloc(words ? words : 1, sizeof(uint64_t));
+    if (!map->walk_bits || !map->gate_bits)
+        return false;
+
+    for (int y = 0; y < map->height; ++y)
+    {
+        uint64_t *row = &map->walk_bits[y * map->walk_words];
+        for (int x = 0; x < map->width; ++x)
+        {
+            if (map->tiles[y][x].symbol == ' ')
+                row[x >> 6] |= (uint64_t)1 << (x & 63);
+        }
+    }
+    map_set_gate_bits(map, &map->gate_entry);
+    map_set_gate_bits(map, &map->gate_exit);
+    return true;
+}
+
+// Walkable bits of word i of row y
+static inline uint64_t walk_word(const Map *map, int y, int i)
+{
+    int w = y * map->walk_words + i;
+    return map->walk_bits[w] & ~map->gate_bits[w];
+}
+
 bool map_is_walkable(const Map *map, int x, int y)
 {
     if (!map_in_bounds(map, x, y))
         return false;
+    return (walk_word(map, y, x >> 6) >> (x & 63)) & 1;
+}
+
+bool map_row_mask_walkable(const Map *map, int x, int y, uint64_t mask)
+{
+    if (!mask)
+        return true;
+    if (y < 0 || y >= map->height)
+        return false;
 
+    // Lowest and highest tile tested must lie on the row
+    int lo = __builtin_ctzll(mask);
+    int hi = 63 - __builtin_clzll(mask);
+    if (x + lo < 0 || x + hi >= map->width)
+        return false;
+    if (x < 0)
+    {
+        mask >>= -x; // only drops zero bits, see the check above
+        x = 0;
+    }
 
-    // Block entry gate tiles if entry gate is closed
-    if (!map->gate_entry.open) {
-        for (int ti = 0; ti < map->gate_entry.tile_count; ++ti) {
-            if (map->gate_entry.xs[ti] == x && map->gate_entry.ys[ti] == y) {
+    // The mask covers at most two words: shift it into place and test
+    int i = x >> 6;
+    int bit = x & 63;
+    if ((mask << bit) & ~walk_word(map, y, i))
+        return false;
+    uint64_t spill = bit ? mask >> (64 - bit) : 0;
+    if (spill && (spill & ~walk_word(map, y, i + 1)))
+        return false;
+    return true;
+}
+
+bool map_rect_walkable(const Map *map, int x, int y, int w, int h)
+{
+    for (int dy = 0; dy < h; ++dy)
+    {
+        // Full 64-tile chunks, then the rest
+        int cx = x;
+        int left = w;
+        for (; left >= 64; cx += 64, left -= 64)
+        {
+            if (!map_row_mask_walkable(map, cx, y + dy, ~(uint64_t)0))
                 return false;
-            }
         }
+        if (left > 0 && !map_row_mask_walkable(map, cx, y + dy, ((uint64_t)1 << left) - 1))
+            return false;
     }
-    // Block exit gate tiles if exit gate is closed
-    if (!map->gate_exit.open) {
-        for (int ti = 0; ti < map->gate_exit.tile_count; ++ti) {
-            if (map->gate_exit.xs[ti] == x && map->gate_exit.ys[ti] == y) {
-                return false;
-            }
+    return true;
+}
+
+// Recompute layer->fits for all anchors in [x0,x1] x [y0,y1] (clamped)
+static void footprint_layer_update(const Map *map, FootprintLayer *layer,
+                                   int x0, int y0, int x1, int y1)
+{
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 >= map->width) x1 = map->width - 1;
+    if (y1 >= map->height) y1 = map->height - 1;
+
+    for (int y = y0; y <= y1; ++y)
+    {
+        for (int x = x0; x <= x1; ++x)
+        {
+            layer->fits[y * map->width + x] =
+                map_rect_walkable(map, x, y, layer->width, layer->height);
         }
     }
+}
+
+// A gate toggled: only anchors whose footprint overlaps a gate tile change,
+// i.e. the columns [gate_x - w + 1, gate_x] of the rows above/at the gate.
+// Log the gate as the change for the current walk_epoch and rebuild the
+// clearance anchors it covers
+static void map_refresh_footprints_near_gate(Map *map, const Gate *gate)
+{
+    MapChange *change = &map->changes[map->walk_epoch % MAP_CHANGE_LOG];
+    *change = (MapChange){map->walk_epoch, 0, 0, -1, -1};
+    if (gate->tile_count == 0)
+        return;
+
+    int gx0 = gate->xs[0], gx1 = gate->xs[0];
+    int gy0 = gate->ys[0], gy1 = gate->ys[0];
+    for (int ti = 1; ti < gate->tile_count; ++ti)
+    {
+        if (gate->xs[ti] < gx0) gx0 = gate->xs[ti];
+        if (gate->xs[ti] > gx1) gx1 = gate->xs[ti];
+        if (gate->ys[ti] < gy0) gy0 = gate->ys[ti];
+        if (gate->ys[ti] > gy1) gy1 = gate->ys[ti];
+    }
+    change->x0 = gx0;
+    change->y0 = gy0;
+    change->x1 = gx1;
+    change->y1 = gy1;
+
+    for (int i = 0; i < map->footprint_count; ++i)
+    {
+        FootprintLayer *layer = &map->footprints[i];
+        footprint_layer_update(map, layer,
+                               gx0 - layer->width + 1, gy0 - layer->height + 1,
+                               gx1, gy1);
+    }
+}
 
-    return map->tiles[y][x].symbol == ' ';
+bool map_add_footprint(Map *map, int width, int height)
+{
+    if (map_get_footprint(map, width, height))
+        return true;
+    if (map->footprint_count >= MAX_FOOTPRINT_LAYERS || width <= 0 || height <= 0)
+        return false;
+
+    FootprintLayer *layer = &map->footprints[map->footprint_count];
+    layer->fits = malloc(map->width * map->height);
+    if (!layer->fits)
+        return false;
+    layer->width = width;
+    layer->height = height;
+    footprint_layer_update(map, layer, 0, 0, map->width - 1, map->height - 1);
+    map->footprint_count++;
+    return true;
+}
+
+const FootprintLayer *map_get_footprint(const Map *map, int width, int height)
+{
+    for (int i = 0; i < map->footprint_count; ++i)
+    {
+        const FootprintLayer *layer = &map->footprints[i];
+        if (layer->width == width && layer->height == height)
+            return layer;
+    }
+    return NULL;
+}
+
+bool map_footprint_fits(const Map *map, int x, int y, int width, int height)
+{
+    if (!map_in_bounds(map, x, y))
+        return false;
+    const FootprintLayer *layer = map_get_footprint(map, width, height);
+    if (layer)
+        return layer->fits[y * map->width + x];
+    return map_rect_walkable(map, x, y, width, height);
 }
 
 void map_print(const Map *map)
@@ -2,6 +2,7 @@
 #define MAP_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "tile.h"
 #include "waypoint.h"
 #include "../common/direction.h"
@@ -27,10 +28,42 @@ typedef struct Map Map;
 // Gate control API (only one gate)
 void map_set_gate_open(Map *map, int open);
 int map_get_gate_open(const Map *map);
+void map_set_exit_gate_open(Map *map, int open);
+// Identifies the current walkability: gates are the only tiles that
+// change, so equal keys mean identical walkable sets (bit0 entry, bit1 exit)
+unsigned int map_walk_key(const Map *map);
+
+// Precomputed clearance for one car footprint:
+// fits[y * map->width + x] is 1 when a width x height car anchored
+// (upper-left) at (x,y) only covers walkable tiles.
+#define MAX_FOOTPRINT_LAYERS 4
+typedef struct {
+    int width;
+    int height;
+    unsigned char *fits;
+} FootprintLayer;
+
+// Tiles whose walkability flipped when walk_epoch became `epoch`
+// (inclusive rectangle, empty if x0 > x1). The last MAP_CHANGE_LOG changes
+// are kept so long-lived search state can be repaired instead of rebuilt.
+#define MAP_CHANGE_LOG 16
+typedef struct {
+    unsigned int epoch;
+    int x0, y0, x1, y1;
+} MapChange;
+
+// Vehicles leave the map at this tile (left edge, behind the exit gate)
+#define MAP_EXIT_X 0
+#define MAP_EXIT_Y 1
 
 #define MAX_WAYPOINTS 32
 #define MAX_PARKING_SPOTS 64
 
+// Sets of parking spots are bitmasks over spot ids
+#define SPOT_MASK_WORDS ((MAX_PARKING_SPOTS + 63) / 64)
+// Side of the square map cells the spot index buckets spots by
+#define SPOT_BUCKET_SIZE 16
+
 typedef struct ParkingSpot
 {
     int id;
@@ -65,6 +98,27 @@ typedef struct Map
     int end_x;
     int end_y;
     int has_end;
+    // Clearance layers, one per registered car footprint
+    FootprintLayer footprints[MAX_FOOTPRINT_LAYERS];
+    int footprint_count;
+    // Bumped whenever walkability changes (gate opened/closed)
+    unsigned int walk_epoch;
+    MapChange changes[MAP_CHANGE_LOG]; // indexed by epoch % MAP_CHANGE_LOG
+    // Walkability bitmaps, walk_words 64-bit words per row; tile (x,y) is
+    // bit x % 64 of word [y * walk_words + x / 64]. walk_bits holds the
+    // static layout, gate_bits the tiles of currently closed gates, so a
+    // tile is walkable when its walk bit is set and its gate bit is not.
+    int walk_words;
+    uint64_t *walk_bits;
+    uint64_t *gate_bits;
+    // Parking occupancy: spot i is free when bit i % 64 of spot_free[i / 64]
+    // is set. spot_buckets holds SPOT_MASK_WORDS words per bucket (row
+    // major, bucket_cols x bucket_rows): the spots whose block overlaps it.
+    uint64_t spot_free[SPOT_MASK_WORDS];
+    int free_spot_count;
+    int bucket_cols;
+    int bucket_rows;
+    uint64_t *spot_buckets;
 } Map;
 
 bool map_load(Map *map, const char *filename);
@@ -72,6 +126,21 @@ void map_free(Map *map);
 
 bool map_in_bounds(const Map *map, int x, int y);
 bool map_is_walkable(const Map *map, int x, int y);
+// True if tile x + i of row y is walkable for every bit i set in mask
+// (e.g. one row of a sprite); tiles off the map count as blocked
+bool map_row_mask_walkable(const Map *map, int x, int y, uint64_t mask);
+// True if every tile of the w x h rectangle anchored at (x,y) is walkable
+bool map_rect_walkable(const Map *map, int x, int y, int w, int h);
+
+// Register a car footprint and build its clearance layer (no-op if known)
+bool map_add_footprint(Map *map, int width, int height);
+// Clearance layer for a footprint, NULL if it was never registered
+const FootprintLayer *map_get_footprint(const Map *map, int width, int height);
+// True if a width x height car anchored at (x,y) fits (O(1) when registered)
+bool map_footprint_fits(const Map *map, int x, int y, int width, int height);
+
+// Change that produced walk_epoch `epoch`, NULL if it fell out of the log
+const MapChange *map_get_change(const Map *map, unsigned int epoch);
 
 void map_print(const Map *map);
 
@@ -82,4 +151,14 @@ void map_build_parking_spots(Map *map);
 
 const ParkingSpot *map_get_parking_spot_with_indicator(const Map *map, int x, int y);
 
+// Mark a spot taken by v / free again. All occupancy changes go through
+// these so the free-spot index stays in sync with spot->occupied.
+void map_occupy_spot(Map *map, ParkingSpot *spot, Vehicle *v);
+void map_release_spot(Map *map, ParkingSpot *spot);
+// Free spots whose block may overlap the inclusive rectangle (x0,y0)-(x1,y1)
+// (bucket granularity: callers still check the exact distance). Returns
+// the number of spots set in mask.
+int map_free_spots_near(const Map *map, int x0, int y0, int x1, int y1,
+                        uint64_t mask[SPOT_MASK_WORDS]);
+
 #endif
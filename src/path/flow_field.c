@@ -0,0 +1,442 @@
+#include "flow_field.h"
+
+#include <stdlib.h>
+
+#include "../common/debug.h"
+#include "../map/map.h"
+
+// Macros to convert between (x,y) and flat index
+#define IDX(x, y, width) ((y) * (width) + (x))
+
+static FlowField g_fields[MAX_FLOW_FIELDS];
+static int g_field_count = 0;
+static int *g_queue = NULL; // BFS scratch, sized for g_num_cells
+static uint16_t *g_old = NULL; // distances of cells cleared by a repair
+static PathHeap g_heap;     // repair open list
+static int g_num_cells = 0;
+static PathBuilder g_builder; // gradient walks are written here first
+static bool g_incremental = true;
+static unsigned long g_repairs = 0;
+static unsigned long g_rebuilds = 0;
+
+// 4 neighbors: E, W, N, S (same order as the searches in path.c)
+static const int dx[4] = {1, -1, 0, 0};
+static const int dy[4] = {0, 0, -1, 1};
+
+static bool fits(const struct Map *map, const FootprintLayer *layer,
+                 int x, int y, int w, int h)
+{
+    if (layer)
+        return layer->fits[IDX(x, y, map->width)];
+    return map_footprint_fits(map, x, y, w, h);
+}
+
+// Reverse BFS from the goal over all anchors where the footprint fits
+static void flow_field_build(const struct Map *map, FlowField *field)
+{
+    int width = map->width;
+    int height = map->height;
+    int num_cells = width * height;
+    const FootprintLayer *layer = map_get_footprint(map, field->car_width, field->car_height);
+
+    for (int i = 0; i < num_cells; ++i)
+        field->dist[i] = FLOW_UNREACHABLE;
+    field->epoch = map->walk_epoch;
+
+    if (!fits(map, layer, field->goal_x, field->goal_y, field->car_width, field->car_height))
+        return;
+
+    int head = 0;
+    int tail = 0;
+    int goal_idx = IDX(field->goal_x, field->goal_y, width);
+    field->dist[goal_idx] = 0;
+    g_queue[tail++] = goal_idx;
+
+    while (head < tail)
+    {
+        int current = g_queue[head++];
+        int cx = current % width;
+        int cy = current / width;
+        uint16_t nd = field->dist[current] + 1;
+        if (nd == FLOW_UNREACHABLE)
+            continue; // distance would not fit in 16 bits
+
+        for (int dir = 0; dir < 4; ++dir)
+        {
+            int nx = cx + dx[dir];
+            int ny = cy + dy[dir];
+            if (nx < 0 || nx >= width || ny < 0 || ny >= height)
+                continue;
+
+            int n_idx = IDX(nx, ny, width);
+            if (field->dist[n_idx] != FLOW_UNREACHABLE)
+                continue;
+            if (!fits(map, layer, nx, ny, field->car_width, field->car_height))
+                continue;
+
+            field->dist[n_idx] = nd;
+            g_queue[tail++] = n_idx;
+        }
+    }
+}
+
+// Largest tile rectangle of anchors whose fit can change with the tiles
+// in `change`, clipped to the map. False if it is empty.
+static bool change_anchor_rect(const struct Map *map, const MapChange *change,
+                               int w, int h, int *x0, int *y0, int *x1, int *y1)
+{
+    *x0 = change->x0 - w + 1;
+    *y0 = change->y0 - h + 1;
+    *x1 = change->x1;
+    *y1 = change->y1;
+    if (*x0 < 0) *x0 = 0;
+    if (*y0 < 0) *y0 = 0;
+    if (*x1 >= map->width) *x1 = map->width - 1;
+    if (*y1 >= map->height) *y1 = map->height - 1;
+    return *x0 <= *x1 && *y0 <= *y1;
+}
+
+// Lower dist[idx] to one more than its best neighbor and queue it
+static int repair_seed(const struct Map *map, FlowField *field, int idx)
+{
+    int width = map->width;
+    int cx = idx % width;
+    int cy = idx / width;
+    int best = FLOW_UNREACHABLE;
+    for (int dir = 0; dir < 4; ++dir)
+    {
+        int nx = cx + dx[dir];
+        int ny = cy + dy[dir];
+        if (!map_in_bounds(map, nx, ny))
+            continue;
+        int nd = field->dist[IDX(nx, ny, width)];
+        if (nd + 1 < best)
+            best = nd + 1;
+    }
+    if (best >= field->dist[idx])
+        return 0;
+    field->dist[idx] = (uint16_t)best;
+    path_heap_push(&g_heap, idx, best, 0);
+    return 1;
+}
+
+// Bring a field from its epoch to map->walk_epoch by touching only the
+// cells affected by the logged gate changes:
+//  1. cells that no longer fit are cleared, and so is every cell whose
+//     distance depended on them (no remaining neighbor one step closer);
+//  2. cleared and newly fitting cells take their best neighbor's distance
+//     and the improvements spread outwards, Dijkstra-style.
+// Returns false if the log does not reach back far enough or a change
+// touches the goal; the caller rebuilds the field then.
+static bool flow_field_repair(const struct Map *map, FlowField *field)
+{
+    int width = map->width;
+    int w = field->car_width;
+    int h = field->car_height;
+    const FootprintLayer *layer = map_get_footprint(map, w, h);
+
+    if (map->walk_epoch - field->epoch > MAP_CHANGE_LOG)
+        return false;
+    for (unsigned int e = field->epoch + 1; e != map->walk_epoch + 1; ++e)
+    {
+        const MapChange *change = map_get_change(map, e);
+        if (!change)
+            return false;
+        int x0, y0, x1, y1;
+        if (change_anchor_rect(map, change, w, h, &x0, &y0, &x1, &y1) &&
+            field->goal_x >= x0 && field->goal_x <= x1 &&
+            field->goal_y >= y0 && field->goal_y <= y1)
+            return false;
+    }
+
+    // 1. Clear blocked anchors and everything that hung off them
+    int tail = 0;
+    for (unsigned int e = field->epoch + 1; e != map->walk_epoch + 1; ++e)
+    {
+        int x0, y0, x1, y1;
+        if (!change_anchor_rect(map, map_get_change(map, e), w, h, &x0, &y0, &x1, &y1))
+            continue;
+        for (int y = y0; y <= y1; ++y)
+            for (int x = x0; x <= x1; ++x)
+            {
+                int idx = IDX(x, y, width);
+                if (field->dist[idx] == FLOW_UNREACHABLE || fits(map, layer, x, y, w, h))
+                    continue;
+                g_old[idx] = field->dist[idx];
+                field->dist[idx] = FLOW_UNREACHABLE;
+                g_queue[tail++] = idx;
+            }
+    }
+    for (int head = 0; head < tail; ++head)
+    {
+        int current = g_queue[head];
+        int cx = current % width;
+        int cy = current / width;
+        int old = g_old[current];
+        for (int dir = 0; dir < 4; ++dir)
+        {
+            int nx = cx + dx[dir];
+            int ny = cy + dy[dir];
+            if (!map_in_bounds(map, nx, ny))
+                continue;
+            int n_idx = IDX(nx, ny, width);
+            int nd = field->dist[n_idx];
+            if (nd != old + 1)
+                continue;
+            bool supported = false;
+            for (int k = 0; k < 4 && !supported; ++k)
+            {
+                int mx = nx + dx[k];
+                int my = ny + dy[k];
+                supported = map_in_bounds(map, mx, my) &&
+                            field->dist[IDX(mx, my, width)] == nd - 1;
+            }
+            if (supported)
+                continue;
+            g_old[n_idx] = (uint16_t)nd;
+            field->dist[n_idx] = FLOW_UNREACHABLE;
+            g_queue[tail++] = n_idx;
+        }
+    }
+    int touched = tail;
+
+    // 2. Re-seed cleared and newly fitting anchors, then spread decreases
+    for (int i = 0; i < tail; ++i)
+        if (fits(map, layer, g_queue[i] % width, g_queue[i] / width, w, h))
+            repair_seed(map, field, g_queue[i]);
+    for (unsigned int e = field->epoch + 1; e != map->walk_epoch + 1; ++e)
+    {
+        int x0, y0, x1, y1;
+        if (!change_anchor_rect(map, map_get_change(map, e), w, h, &x0, &y0, &x1, &y1))
+            continue;
+        for (int y = y0; y <= y1; ++y)
+            for (int x = x0; x <= x1; ++x)
+                if (fits(map, layer, x, y, w, h))
+                    repair_seed(map, field, IDX(x, y, width));
+    }
+    while (!path_heap_empty(&g_heap))
+    {
+        PathHeapNode node = path_heap_pop(&g_heap);
+        touched++;
+        int cx = node.idx % width;
+        int cy = node.idx / width;
+        int nd = field->dist[node.idx] + 1;
+        if (nd >= FLOW_UNREACHABLE)
+            continue;
+        for (int dir = 0; dir < 4; ++dir)
+        {
+            int nx = cx + dx[dir];
+            int ny = cy + dy[dir];
+            if (!map_in_bounds(map, nx, ny))
+                continue;
+            int n_idx = IDX(nx, ny, width);
+            if (field->dist[n_idx] <= nd || !fits(map, layer, nx, ny, w, h))
+                continue;
+            field->dist[n_idx] = (uint16_t)nd;
+            path_heap_push(&g_heap, n_idx, nd, 0);
+        }
+    }
+
+    debug_log("[flow] Repaired field to (%d,%d) for %dx%d: %d of %d cells touched\n",
+              field->goal_x, field->goal_y, w, h, touched, g_num_cells);
+    field->epoch = map->walk_epoch;
+    return true;
+}
+
+// Find the field for (goal, footprint), creating it if there is room.
+// Returns NULL if the goal is off the map or all slots are taken.
+static FlowField *flow_field_get(const struct Map *map, int gx, int gy, int w, int h)
+{
+    if (!map_in_bounds(map, gx, gy))
+        return NULL;
+
+    int num_cells = map->width * map->height;
+    if (num_cells != g_num_cells)
+    {
+        // New map: drop everything sized for the old one
+        flow_fields_free();
+        g_queue = malloc(num_cells * sizeof(int));
+        g_old = malloc(num_cells * sizeof(uint16_t));
+        if (!g_queue || !g_old || !path_heap_init(&g_heap, num_cells))
+        {
+            flow_fields_free();
+            return NULL;
+        }
+        g_num_cells = num_cells;
+    }
+
+    FlowField *field = NULL;
+    for (int i = 0; i < g_field_count; ++i)
+    {
+        FlowField *f = &g_fields[i];
+        if (f->goal_x == gx && f->goal_y == gy && f->car_width == w && f->car_height == h)
+        {
+            field = f;
+            break;
+        }
+    }
+
+    if (!field)
+    {
+        if (g_field_count >= MAX_FLOW_FIELDS)
+            return NULL;
+        field = &g_fields[g_field_count];
+        field->dist = malloc(num_cells * sizeof(uint16_t));
+        if (!field->dist)
+            return NULL;
+        field->goal_x = gx;
+        field->goal_y = gy;
+        field->car_width = w;
+        field->car_height = h;
+        g_field_count++;
+        flow_field_build(map, field);
+        debug_log("[flow] Built field %d to (%d,%d) for %dx%d\n", g_field_count - 1, gx, gy, w, h);
+    }
+    else if (field->epoch != map->walk_epoch)
+    {
+        if (g_incremental && flow_field_repair(map, field))
+        {
+            g_repairs++;
+        }
+        else
+        {
+            flow_field_build(map, field);
+            g_rebuilds++;
+        }
+    }
+    return field;
+}
+
+void flow_fields_precompute(const struct Map *map, int car_width, int car_height)
+{
+    for (int i = 0; i < map->waypoint_count; ++i)
+        flow_field_get(map, map->waypoints[i].x, map->waypoints[i].y, car_width, car_height);
+    for (int i = 0; i < map->parking_count; ++i)
+        flow_field_get(map, map->parkings[i].x0, map->parkings[i].y0, car_width, car_height);
+    if (map->has_end)
+        flow_field_get(map, map->end_x, map->end_y, car_width, car_height);
+    flow_field_get(map, MAP_EXIT_X, MAP_EXIT_Y, car_width, car_height);
+}
+
+void flow_fields_refresh(const struct Map *map)
+{
+    for (int i = 0; i < g_field_count; ++i)
+        flow_field_get(map, g_fields[i].goal_x, g_fields[i].goal_y,
+                       g_fields[i].car_width, g_fields[i].car_height);
+}
+
+void flow_fields_set_incremental(bool enabled)
+{
+    g_incremental = enabled;
+}
+
+void flow_fields_stats(unsigned long *repairs, unsigned long *rebuilds)
+{
+    if (repairs)
+        *repairs = g_repairs;
+    if (rebuilds)
+        *rebuilds = g_rebuilds;
+}
+
+void flow_fields_free(void)
+{
+    for (int i = 0; i < g_field_count; ++i)
+    {
+        free(g_fields[i].dist);
+        g_fields[i].dist = NULL;
+    }
+    g_field_count = 0;
+    free(g_queue);
+    g_queue = NULL;
+    free(g_old);
+    g_old = NULL;
+    path_heap_free(&g_heap);
+    g_num_cells = 0;
+    path_builder_free(&g_builder);
+}
+
+// Follow the field's gradient from (sx,sy): every step goes to a
+// neighbor one closer. Only reads the field.
+static const Path *flow_field_walk(const struct Map *map, const FlowField *field,
+                                   PathBuilder *b, int sx, int sy)
+{
+    int width = map->width;
+    int cur = IDX(sx, sy, width);
+    uint16_t d = field->dist[cur];
+    if (d == FLOW_UNREACHABLE)
+        return NULL;
+
+    path_builder_start(b, sx, sy);
+    while (d > 0)
+    {
+        int cx = cur % width;
+        int cy = cur / width;
+        for (int dir = 0; dir < 4; ++dir)
+        {
+            int nx = cx + dx[dir];
+            int ny = cy + dy[dir];
+            if (!map_in_bounds(map, nx, ny))
+                continue;
+            int n_idx = IDX(nx, ny, width);
+            if (field->dist[n_idx] == d - 1)
+            {
+                cur = n_idx;
+                break;
+            }
+        }
+        d--;
+        if (!path_builder_step(b, cur % width, cur / width))
+            return NULL;
+    }
+    return path_builder_share(b);
+}
+
+const Path *flow_field_find_path(const struct Map *map,
+                                 int sx, int sy,
+                                 int gx, int gy,
+                                 int car_width, int car_height)
+{
+    if (!map_in_bounds(map, sx, sy))
+        return NULL;
+
+    const FlowField *field = flow_field_get(map, gx, gy, car_width, car_height);
+    if (!field)
+    {
+        // No field available: plain search
+        if (car_width == 1 && car_height == 1)
+            return path_find(map, sx, sy, gx, gy);
+        return path_find_with_size(map, sx, sy, gx, gy, car_width, car_height);
+    }
+    return flow_field_walk(map, field, &g_builder, sx, sy);
+}
+
+bool flow_field_prepare(const struct Map *map, int gx, int gy, int car_width, int car_height)
+{
+    return flow_field_get(map, gx, gy, car_width, car_height) != NULL;
+}
+
+const Path *flow_field_find_path_ws(PathWorkspace *ws,
+                                    const struct Map *map,
+                                    int sx, int sy,
+                                    int gx, int gy,
+                                    int car_width, int car_height)
+{
+    if (!map_in_bounds(map, sx, sy))
+        return NULL;
+
+    if (map->width * map->height == g_num_cells)
+    {
+        for (int i = 0; i < g_field_count; ++i)
+        {
+            const FlowField *f = &g_fields[i];
+            if (f->goal_x == gx && f->goal_y == gy &&
+                f->car_width == car_width && f->car_height == car_height &&
+                f->epoch == map->walk_epoch)
+                return flow_field_walk(map, f, &ws->builder, sx, sy);
+        }
+    }
+
+    if (car_width == 1 && car_height == 1)
+        return path_find_ws(ws, map, sx, sy, gx, gy);
+    return path_find_with_size_ws(ws, map, sx, sy, gx, gy, car_width, car_height);
+}
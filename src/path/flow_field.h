@@ -0,0 +1,68 @@
+#ifndef FLOW_FIELD_H
+#define FLOW_FIELD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "path.h"
+
+struct Map;
+
+#define MAX_FLOW_FIELDS 256
+#define FLOW_UNREACHABLE 0xFFFF
+
+// Distance to one goal from every anchor where a car_width x car_height
+// footprint fits (reverse BFS, unit cost, 4-connected). A 1x1 footprint
+// matches path_find's plain tile walkability.
+typedef struct
+{
+    int goal_x, goal_y;
+    int car_width, car_height;
+    unsigned int epoch; // map->walk_epoch the field was built for
+    uint16_t *dist;     // dist[y * width + x], FLOW_UNREACHABLE if no route
+} FlowField;
+
+// Build fields towards every static goal of the map (waypoints, parking
+// spot anchors, exit entry 'E' and the exit tile) for one footprint.
+void flow_fields_precompute(const struct Map *map, int car_width, int car_height);
+
+// Bring every field up to the map's current walk_epoch. After a gate
+// toggle only the cells around the gate are repaired (see
+// MAP_CHANGE_LOG); fields fall back to a full rebuild when the change log
+// no longer reaches back to their epoch or the gate covers their goal.
+// Fields are also refreshed lazily by flow_field_find_path.
+void flow_fields_refresh(const struct Map *map);
+
+// Turn incremental repair off to always rebuild (for comparisons)
+void flow_fields_set_incremental(bool enabled);
+
+// Number of stale fields repaired / rebuilt so far
+void flow_fields_stats(unsigned long *repairs, unsigned long *rebuilds);
+
+// Release all fields
+void flow_fields_free(void);
+
+// Shortest path from (sx,sy) to (gx,gy) read off the goal's flow field
+// (no search). Fields are built on first use and repaired when the map's
+// walkability epoch changed. Falls back to path_find / path_find_with_size
+// if no field slot is left.
+// Returns the path (one reference for the caller) or NULL.
+const Path *flow_field_find_path(const struct Map *map,
+                                 int sx, int sy,
+                                 int gx, int gy,
+                                 int car_width, int car_height);
+
+// Make sure the field for (goal, footprint) exists and is current, so
+// flow_field_find_path_ws can use it. False if no field slot is left.
+bool flow_field_prepare(const struct Map *map, int gx, int gy, int car_width, int car_height);
+
+// Same result as flow_field_find_path, but never creates or repairs a
+// field: the gradient walk and any fallback search use the caller's
+// workspace. Safe to call from several threads at once (one workspace
+// each) while nothing modifies the map or the fields.
+const Path *flow_field_find_path_ws(PathWorkspace *ws,
+                                    const struct Map *map,
+                                    int sx, int sy,
+                                    int gx, int gy,
+                                    int car_width, int car_height);
+
+#endif // FLOW_FIELD_H
@@ -1,239 +1,702 @@
-// Macros to convert between (x,y) and flat index
-#define IDX(x, y, width) ((y) * (width) + (x))
+#include "path.h"
 
+#include <pthread.h>
 #include <stdlib.h>
-#include <stdbool.h>
-#include "../vehicle/vehicle.h"
+#include <string.h>
 #include <stdio.h>
-// Helper: check if car of size (w,h) fits at (x,y) on map
-static int car_fits_at(const struct Map *map, int x, int y, int w, int h) {
-    for (int dy = 0; dy < h; ++dy) {
-        for (int dx = 0; dx < w; ++dx) {
-            int tx = x + dx;
-            int ty = y + dy;
-            if (!map_is_walkable(map, tx, ty)) {
-                return 0;
-            }
-        }
+
+#include "../map/map.h"
+
+// Macros to convert between (x,y) and flat index
+#define IDX(x, y, width) ((y) * (width) + (x))
+
+#define PATH_INF 99999999
+
+// Number of buffer allocations made for path searches (see path_alloc_count)
+static unsigned long g_path_allocs = 0;
+
+// Workspace behind the workspace-less API (single-threaded callers only)
+static PathWorkspace g_default_ws;
+
+// Algorithm used by path_find_with_size(_ws)
+static PathPlanner g_planner = PATH_PLANNER_ASTAR;
+
+// Shared pool of released paths, bucketed by segment capacity
+// (8 << class segments). Bigger paths are malloc'd and freed directly.
+#define PATH_POOL_CLASSES 8
+#define PATH_POOL_MIN_SEGS 8
+#define PATH_SEG_MAX_RUN 0xFFFF
+
+static Path *g_pool_free[PATH_POOL_CLASSES];
+
+// Guards the pool and g_path_allocs: batch planning (path_batch.c) builds
+// paths on worker threads. Reference counts are atomic instead: the
+// render thread holds references to the paths it draws.
+static pthread_mutex_t g_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int pool_class_for(int seg_count)
+{
+    int cap = PATH_POOL_MIN_SEGS;
+    for (int c = 0; c < PATH_POOL_CLASSES; ++c, cap <<= 1)
+    {
+        if (seg_count <= cap)
+            return c;
     }
-    return 1;
+    return -1;
 }
 
-bool path_find_with_size(const struct Map *map,
-                        int sx, int sy,
-                        int gx, int gy,
-                        int car_width, int car_height,
-                        Path *out_path)
+static Path *pool_alloc(int seg_count)
 {
-    path_init(out_path);
+    int c = pool_class_for(seg_count);
+    pthread_mutex_lock(&g_pool_lock);
+    if (c >= 0 && g_pool_free[c])
+    {
+        Path *p = g_pool_free[c];
+        // Free paths chain through their first segment slot
+        memcpy(&g_pool_free[c], p->segs, sizeof(Path *));
+        pthread_mutex_unlock(&g_pool_lock);
+        return p;
+    }
+    pthread_mutex_unlock(&g_pool_lock);
+
+    int cap = c >= 0 ? (PATH_POOL_MIN_SEGS << c) : seg_count;
+    size_t segs_size = cap * sizeof(PathSegment);
+    if (segs_size < sizeof(Path *))
+        segs_size = sizeof(Path *);
+    Path *p = malloc(sizeof(Path) + segs_size);
+    if (!p)
+        return NULL;
+    pthread_mutex_lock(&g_pool_lock);
+    g_path_allocs++;
+    pthread_mutex_unlock(&g_pool_lock);
+    p->pool_class = c;
+    return p;
+}
 
-    int width = map->width;
-    int height = map->height;
-    int num_cells = width * height;
+static void pool_free(Path *p)
+{
+    int c = p->pool_class;
+    if (c < 0)
+    {
+        free(p);
+        return;
+    }
+    pthread_mutex_lock(&g_pool_lock);
+    memcpy(p->segs, &g_pool_free[c], sizeof(Path *));
+    g_pool_free[c] = p;
+    pthread_mutex_unlock(&g_pool_lock);
+}
 
-    // Check if start/goal inside map and car fits
-    if (sx < 0 || sx >= width || sy < 0 || sy >= height)
-        return false;
-    if (gx < 0 || gx >= width || gy < 0 || gy >= height)
-        return false;
+const Path *path_retain(const Path *p)
+{
+    if (p)
+        __atomic_add_fetch(&((Path *)p)->refs, 1, __ATOMIC_RELAXED);
+    return p;
+}
 
-    if (!car_fits_at(map, sx, sy, car_width, car_height))
+void path_release(const Path *p)
+{
+    if (!p)
+        return;
+    Path *mp = (Path *)p;
+    if (__atomic_sub_fetch(&mp->refs, 1, __ATOMIC_ACQ_REL) == 0)
+        pool_free(mp);
+}
+
+void path_dir_delta(Direction dir, int *dx, int *dy)
+{
+    *dx = 0;
+    *dy = 0;
+    switch (dir)
+    {
+    case DIR_NORTH: *dy = -1; break;
+    case DIR_SOUTH: *dy = 1; break;
+    case DIR_WEST:  *dx = -1; break;
+    case DIR_EAST:  *dx = 1; break;
+    }
+}
+
+void path_iter_init(PathIter *it, const Path *p)
+{
+    it->path = p;
+    it->seg = 0;
+    it->offset = 0;
+    it->index = 0;
+    it->x = p ? p->start_x : 0;
+    it->y = p ? p->start_y : 0;
+}
+
+bool path_iter_has_next(const PathIter *it)
+{
+    return it->path && it->index + 1 < it->path->length;
+}
+
+void path_iter_peek(const PathIter *it, int *next_x, int *next_y)
+{
+    int dx, dy;
+    path_dir_delta((Direction)it->path->segs[it->seg].dir, &dx, &dy);
+    *next_x = it->x + dx;
+    *next_y = it->y + dy;
+}
+
+void path_iter_advance(PathIter *it)
+{
+    path_iter_peek(it, &it->x, &it->y);
+    it->index++;
+    if (++it->offset >= it->path->segs[it->seg].run)
+    {
+        it->seg++;
+        it->offset = 0;
+    }
+}
+
+void path_builder_init(PathBuilder *b)
+{
+    b->segs = NULL;
+    b->seg_capacity = 0;
+    path_builder_start(b, 0, 0);
+}
+
+void path_builder_free(PathBuilder *b)
+{
+    free(b->segs);
+    b->segs = NULL;
+    b->seg_capacity = 0;
+    b->seg_count = 0;
+}
+
+void path_builder_start(PathBuilder *b, int x, int y)
+{
+    b->start_x = x;
+    b->start_y = y;
+    b->x = x;
+    b->y = y;
+    b->length = 1;
+    b->seg_count = 0;
+}
+
+bool path_builder_step(PathBuilder *b, int x, int y)
+{
+    Direction dir;
+    if (x == b->x + 1 && y == b->y)
+        dir = DIR_EAST;
+    else if (x == b->x - 1 && y == b->y)
+        dir = DIR_WEST;
+    else if (x == b->x && y == b->y - 1)
+        dir = DIR_NORTH;
+    else if (x == b->x && y == b->y + 1)
+        dir = DIR_SOUTH;
+    else
         return false;
-    if (!car_fits_at(map, gx, gy, car_width, car_height))
+
+    PathSegment *last = b->seg_count > 0 ? &b->segs[b->seg_count - 1] : NULL;
+    if (last && last->dir == dir && last->run < PATH_SEG_MAX_RUN)
+    {
+        last->run++;
+    }
+    else
+    {
+        if (b->seg_count == b->seg_capacity)
+        {
+            int cap = b->seg_capacity ? b->seg_capacity * 2 : 64;
+            PathSegment *segs = realloc(b->segs, cap * sizeof(PathSegment));
+            if (!segs)
+                return false;
+            pthread_mutex_lock(&g_pool_lock);
+            g_path_allocs++;
+            pthread_mutex_unlock(&g_pool_lock);
+            b->segs = segs;
+            b->seg_capacity = cap;
+        }
+        b->segs[b->seg_count].dir = (uint8_t)dir;
+        b->segs[b->seg_count].run = 1;
+        b->seg_count++;
+    }
+    b->x = x;
+    b->y = y;
+    b->length++;
+    return true;
+}
+
+const Path *path_builder_share(const PathBuilder *b)
+{
+    Path *p = pool_alloc(b->seg_count);
+    if (!p)
+        return NULL;
+    p->start_x = b->start_x;
+    p->start_y = b->start_y;
+    p->length = b->length;
+    p->seg_count = b->seg_count;
+    p->refs = 1;
+    memcpy(p->segs, b->segs, b->seg_count * sizeof(PathSegment));
+    return p;
+}
+
+unsigned long path_alloc_count(void)
+{
+    return g_path_allocs;
+}
+
+void path_set_planner(PathPlanner planner)
+{
+    g_planner = planner;
+}
+
+PathPlanner path_get_planner(void)
+{
+    return g_planner;
+}
+
+bool path_workspace_init(PathWorkspace *ws, const struct Map *map)
+{
+    int num_cells = map->width * map->height;
+
+    memset(ws, 0, sizeof(*ws));
+    ws->stamp = calloc(num_cells, sizeof(unsigned int));
+    ws->g_score = malloc(num_cells * sizeof(int));
+    ws->came_from = malloc(num_cells * sizeof(int));
+    ws->queue = malloc(num_cells * sizeof(int));
+    bool heap_ok = path_heap_init(&ws->heap, num_cells);
+    path_builder_init(&ws->builder);
+    pthread_mutex_lock(&g_pool_lock);
+    g_path_allocs += 6; // four arrays + the heap's two
+    pthread_mutex_unlock(&g_pool_lock);
+
+    if (!ws->stamp || !ws->g_score || !ws->came_from || !ws->queue || !heap_ok)
+    {
+        path_workspace_free(ws);
         return false;
+    }
+    ws->num_cells = num_cells;
+    ws->generation = 0;
+    return true;
+}
 
-    int start_idx = IDX(sx, sy, width);
-    int goal_idx = IDX(gx, gy, width);
+void path_workspace_free(PathWorkspace *ws)
+{
+    free(ws->stamp);
+    free(ws->g_score);
+    free(ws->came_from);
+    free(ws->queue);
+    path_heap_free(&ws->heap);
+    path_builder_free(&ws->builder);
+    ws->stamp = NULL;
+    ws->g_score = NULL;
+    ws->came_from = NULL;
+    ws->queue = NULL;
+    ws->num_cells = 0;
+}
 
-    // Trivial case: start == goal
-    if (start_idx == goal_idx)
+// Start a new search: every cell becomes unvisited in O(1) by bumping
+// the generation. Stamps are only wiped when the counter wraps.
+static void workspace_begin(PathWorkspace *ws)
+{
+    ws->generation++;
+    if (ws->generation == 0)
     {
-        out_path->length = 1;
-        out_path->steps[0].x = sx;
-        out_path->steps[0].y = sy;
-        return true;
+        memset(ws->stamp, 0, ws->num_cells * sizeof(unsigned int));
+        ws->generation = 1;
     }
+    path_heap_clear(&ws->heap);
+}
 
+static inline bool ws_visited(const PathWorkspace *ws, int idx)
+{
+    return ws->stamp[idx] == ws->generation;
+}
 
-    // --- Path finding implementation ---
-    typedef struct {
-        int idx;
-        int f; // total cost = g + h
-    } HeapNode;
-    // Binary min-heap for up to num_cells
-    HeapNode *heap = malloc(num_cells * sizeof(HeapNode));
-    int heap_size = 0;
-    int *g_score = malloc(num_cells * sizeof(int));
-    int *came_from = malloc(num_cells * sizeof(int));
-    unsigned char *visited = calloc(num_cells, sizeof(unsigned char));
-    if (!heap || !g_score || !came_from || !visited) {
-        free(heap); free(g_score); free(came_from); free(visited);
-        return false;
+static inline void ws_visit(PathWorkspace *ws, int idx, int g, int from)
+{
+    ws->stamp[idx] = ws->generation;
+    ws->g_score[idx] = g;
+    ws->came_from[idx] = from;
+}
+
+static inline int ws_g(const PathWorkspace *ws, int idx)
+{
+    return ws_visited(ws, idx) ? ws->g_score[idx] : PATH_INF;
+}
+
+// Lazily (re)size the shared default workspace for this map
+static PathWorkspace *default_workspace(const struct Map *map)
+{
+    int num_cells = map->width * map->height;
+    if (g_default_ws.num_cells == num_cells)
+        return &g_default_ws;
+
+    path_workspace_free(&g_default_ws);
+    if (!path_workspace_init(&g_default_ws, map))
+        return NULL;
+    return &g_default_ws;
+}
+
+// Walk came_from back from goal to start and build the path start -> goal.
+// Consecutive came_from entries share a row or column (unit steps for
+// A*/BFS, longer straight runs for JPS jump points).
+static const Path *path_reconstruct(PathWorkspace *ws, int width,
+                                    int start_idx, int goal_idx)
+{
+    // Collect the chain back to front in the (now unused) BFS queue
+    int *chain = ws->queue;
+    int count = 0;
+    for (int cur = goal_idx; ; cur = ws->came_from[cur])
+    {
+        if (cur == -1 || count >= ws->num_cells)
+            return NULL; // broken chain
+        chain[count++] = cur;
+        if (cur == start_idx)
+            break;
     }
-    for (int i = 0; i < num_cells; ++i) {
-        g_score[i] = 99999999;
-        came_from[i] = -1;
+
+    PathBuilder *b = &ws->builder;
+    path_builder_start(b, start_idx % width, start_idx / width);
+    for (int i = count - 2; i >= 0; --i)
+    {
+        int tx = chain[i] % width;
+        int ty = chain[i] / width;
+        int step_x = (tx > b->x) - (tx < b->x);
+        int step_y = (ty > b->y) - (ty < b->y);
+        while (b->x != tx || b->y != ty)
+        {
+            if (!path_builder_step(b, b->x + step_x, b->y + step_y))
+                return NULL;
+        }
     }
-    g_score[start_idx] = 0;
-    // Heap push
-    heap[heap_size++] = (HeapNode){start_idx, abs(sx-gx)+abs(sy-gy)};
-    visited[start_idx] = 1;
+    return path_builder_share(b);
+}
+
+// Path of a single tile (start == goal)
+static const Path *path_single_tile(PathWorkspace *ws, int x, int y)
+{
+    path_builder_start(&ws->builder, x, y);
+    return path_builder_share(&ws->builder);
+}
+
+// Helper: check if car of size (w,h) fits at (x,y) on map.
+// Uses the map's clearance layer when the footprint is registered.
+static int car_fits_at(const struct Map *map, const FootprintLayer *layer,
+                       int x, int y, int w, int h)
+{
+    if (layer)
+        return layer->fits[IDX(x, y, map->width)];
+    return map_footprint_fits(map, x, y, w, h);
+}
+
+// --- Jump Point Search (4-connected) ---
+// Straight runs are skipped until a jump point: the goal, a tile with a
+// forced neighbor, or (for vertical runs) a tile from which a horizontal
+// run reaches a jump point. Consecutive jump points always share a row or
+// a column, so the result expands back into unit steps.
+typedef struct
+{
+    const struct Map *map;
+    const FootprintLayer *layer;
+    int car_width, car_height;
+    int gx, gy;
+} JpsContext;
+
+static inline int jps_ok(const JpsContext *c, int x, int y)
+{
+    if (x < 0 || y < 0 || x >= c->map->width || y >= c->map->height)
+        return 0;
+    return car_fits_at(c->map, c->layer, x, y, c->car_width, c->car_height);
+}
+
+// Jump from (x,y) in direction (dx,dy); (x,y) is the first tile after the
+// parent. Returns the jump point's flat index or -1.
+static int jps_jump(const JpsContext *c, int x, int y, int dx, int dy)
+{
+    for (;; x += dx, y += dy)
+    {
+        if (!jps_ok(c, x, y))
+            return -1;
+        if (x == c->gx && y == c->gy)
+            return IDX(x, y, c->map->width);
+
+        if (dx != 0)
+        {
+            if ((jps_ok(c, x, y - 1) && !jps_ok(c, x - dx, y - 1)) ||
+                (jps_ok(c, x, y + 1) && !jps_ok(c, x - dx, y + 1)))
+                return IDX(x, y, c->map->width);
+        }
+        else
+        {
+            if ((jps_ok(c, x - 1, y) && !jps_ok(c, x - 1, y - dy)) ||
+                (jps_ok(c, x + 1, y) && !jps_ok(c, x + 1, y - dy)))
+                return IDX(x, y, c->map->width);
+            // Vertical runs stop where a horizontal run finds something
+            if (jps_jump(c, x + 1, y, 1, 0) >= 0 || jps_jump(c, x - 1, y, -1, 0) >= 0)
+                return IDX(x, y, c->map->width);
+        }
+    }
+}
+
+static const Path *jps_search(PathWorkspace *ws, const JpsContext *c,
+                              int sx, int sy)
+{
+    int width = c->map->width;
+    int start_idx = IDX(sx, sy, width);
+    int goal_idx = IDX(c->gx, c->gy, width);
+
+    workspace_begin(ws);
+    ws_visit(ws, start_idx, 0, -1);
+    int start_h = abs(sx - c->gx) + abs(sy - c->gy);
+    path_heap_push(&ws->heap, start_idx, start_h, start_h);
+
     const int dx[4] = {1, -1, 0, 0};
     const int dy[4] = {0, 0, -1, 1};
     int found = 0;
-    while (heap_size > 0) {
-        // Pop min-f node
-        int min_idx = 0;
-        for (int i = 1; i < heap_size; ++i) {
-            if (heap[i].f < heap[min_idx].f) min_idx = i;
+
+    while (!path_heap_empty(&ws->heap))
+    {
+        int current = path_heap_pop(&ws->heap).idx;
+        if (current == goal_idx)
+        {
+            found = 1;
+            break;
         }
-        HeapNode node = heap[min_idx];
-        heap[min_idx] = heap[--heap_size];
-        int current = node.idx;
-        if (current == goal_idx) { found = 1; break; }
+
         int cx = current % width;
         int cy = current / width;
-        for (int dir = 0; dir < 4; ++dir) {
-            int nx = cx + dx[dir];
-            int ny = cy + dy[dir];
-            if (nx < 0 || nx >= width || ny < 0 || ny >= height) continue;
-            int n_idx = IDX(nx, ny, width);
-            if (!car_fits_at(map, nx, ny, car_width, car_height)) continue;
-            int tentative_g = g_score[current] + 1;
-            if (tentative_g < g_score[n_idx]) {
-                g_score[n_idx] = tentative_g;
-                came_from[n_idx] = current;
-                int h = abs(nx-gx) + abs(ny-gy);
-                int f = tentative_g + h;
-                // Only add to heap if not already visited or better path found
-                int already_in_heap = 0;
-                for (int i = 0; i < heap_size; ++i) if (heap[i].idx == n_idx) { already_in_heap = 1; if (heap[i].f > f) heap[i].f = f; break; }
-                if (!already_in_heap) {
-                    heap[heap_size++] = (HeapNode){n_idx, f};
-                }
-            }
+        int parent = ws->came_from[current];
+        int pdx = 0, pdy = 0;
+        if (parent >= 0)
+        {
+            int px = parent % width;
+            int py = parent / width;
+            pdx = (cx > px) - (cx < px);
+            pdy = (cy > py) - (cy < py);
         }
-    }
-    free(g_score);
-    free(heap);
-    if (!found) {
-        free(visited); free(came_from);
-        return false;
-    }
 
-    int path_buf_len = 0;
-    int cur = goal_idx;
-    while (cur != -1 && cur != start_idx)
-    {
-        int x = cur % width;
-        int y = cur / width;
-        if (path_buf_len >= MAX_PATH_STEPS)
+        for (int dir = 0; dir < 4; ++dir)
         {
-            free(visited);
-            free(came_from);
-            return false;
+            // Pruning: never head straight back towards the parent
+            if (parent >= 0 && dx[dir] == -pdx && dy[dir] == -pdy)
+                continue;
+
+            int jp = jps_jump(c, cx + dx[dir], cy + dy[dir], dx[dir], dy[dir]);
+            if (jp < 0)
+                continue;
+
+            int jx = jp % width;
+            int jy = jp / width;
+            int tentative_g = ws->g_score[current] + abs(jx - cx) + abs(jy - cy);
+            if (tentative_g >= ws_g(ws, jp))
+                continue;
+
+            ws_visit(ws, jp, tentative_g, current);
+            int h = abs(jx - c->gx) + abs(jy - c->gy);
+            path_heap_push(&ws->heap, jp, tentative_g + h, h);
         }
-        out_path->steps[path_buf_len].x = x;
-        out_path->steps[path_buf_len].y = y;
-        path_buf_len++;
-        cur = came_from[cur];
     }
-    if (path_buf_len >= MAX_PATH_STEPS)
-    {
-        free(visited);
-        free(came_from);
-        return false;
-    }
-    out_path->steps[path_buf_len].x = sx;
-    out_path->steps[path_buf_len].y = sy;
-    path_buf_len++;
-    for (int i = 0; i < path_buf_len / 2; ++i)
+
+    if (!found)
+        return NULL;
+
+    // Jump points expand into straight runs of unit steps
+    return path_reconstruct(ws, width, start_idx, goal_idx);
+}
+
+// Manhattan distance from (x,y) to the rectangle [gx0,gx1] x [gy0,gy1]
+static inline int rect_distance(int x, int y, int gx0, int gy0, int gx1, int gy1)
+{
+    int dx = x < gx0 ? gx0 - x : (x > gx1 ? x - gx1 : 0);
+    int dy = y < gy0 ? gy0 - y : (y > gy1 ? y - gy1 : 0);
+    return dx + dy;
+}
+
+// A* over an indexed binary heap towards the cheapest anchor inside the
+// goal rectangle where the footprint fits (a single tile for point goals).
+static const Path *astar_search(PathWorkspace *ws,
+                                const struct Map *map,
+                                const FootprintLayer *layer,
+                                int sx, int sy,
+                                int gx0, int gy0, int gx1, int gy1,
+                                int car_width, int car_height)
+{
+    int width = map->width;
+    int height = map->height;
+    int start_idx = IDX(sx, sy, width);
+
+    workspace_begin(ws);
+    ws_visit(ws, start_idx, 0, -1);
+    int start_h = rect_distance(sx, sy, gx0, gy0, gx1, gy1);
+    path_heap_push(&ws->heap, start_idx, start_h, start_h);
+
+    const int dx[4] = {1, -1, 0, 0};
+    const int dy[4] = {0, 0, -1, 1};
+    int goal_idx = -1;
+
+    while (!path_heap_empty(&ws->heap))
     {
-        PathStep tmp = out_path->steps[i];
-        out_path->steps[i] = out_path->steps[path_buf_len - 1 - i];
-        out_path->steps[path_buf_len - 1 - i] = tmp;
+        PathHeapNode node = path_heap_pop(&ws->heap);
+        int current = node.idx;
+        // Every expanded tile fits, so h == 0 means we reached a goal
+        if (node.h == 0)
+        {
+            goal_idx = current;
+            break;
+        }
+
+        int cx = current % width;
+        int cy = current / width;
+        int tentative_g = ws->g_score[current] + 1;
+
+        for (int dir = 0; dir < 4; ++dir)
+        {
+            int nx = cx + dx[dir];
+            int ny = cy + dy[dir];
+            if (nx < 0 || nx >= width || ny < 0 || ny >= height)
+                continue;
+
+            int n_idx = IDX(nx, ny, width);
+            if (tentative_g >= ws_g(ws, n_idx))
+                continue;
+            if (!car_fits_at(map, layer, nx, ny, car_width, car_height))
+                continue;
+
+            ws_visit(ws, n_idx, tentative_g, current);
+            int h = rect_distance(nx, ny, gx0, gy0, gx1, gy1);
+            // Inserts, or decreases the key if already queued
+            path_heap_push(&ws->heap, n_idx, tentative_g + h, h);
+        }
     }
-    out_path->length = path_buf_len;
-    free(visited);
-    free(came_from);
-    return true;
+
+    if (goal_idx < 0)
+        return NULL;
+    return path_reconstruct(ws, width, start_idx, goal_idx);
 }
-#include "path.h"
 
-#include <stdlib.h>
+const Path *path_find_with_size(const struct Map *map,
+                                int sx, int sy,
+                                int gx, int gy,
+                                int car_width, int car_height)
+{
+    PathWorkspace *ws = default_workspace(map);
+    if (!ws)
+        return NULL;
+    return path_find_with_size_ws(ws, map, sx, sy, gx, gy,
+                                  car_width, car_height);
+}
 
-#include <string.h>
-#include <stdio.h>
+const Path *path_find_with_size_ws(PathWorkspace *ws,
+                                   const struct Map *map,
+                                   int sx, int sy,
+                                   int gx, int gy,
+                                   int car_width, int car_height)
+{
+    int width = map->width;
+    int height = map->height;
 
-#include "../map/map.h"
+    // Check if start/goal inside map and car fits
+    if (sx < 0 || sx >= width || sy < 0 || sy >= height)
+        return NULL;
+    if (gx < 0 || gx >= width || gy < 0 || gy >= height)
+        return NULL;
 
-// Macros to convert between (x,y) and flat index
-#define IDX(x, y, width) ((y) * (width) + (x))
+    const FootprintLayer *layer = map_get_footprint(map, car_width, car_height);
+    if (!car_fits_at(map, layer, sx, sy, car_width, car_height))
+        return NULL;
+    if (!car_fits_at(map, layer, gx, gy, car_width, car_height))
+        return NULL;
 
-void path_init(Path *p)
+    int start_idx = IDX(sx, sy, width);
+    int goal_idx = IDX(gx, gy, width);
+
+    // Trivial case: start == goal
+    if (start_idx == goal_idx)
+        return path_single_tile(ws, sx, sy);
+
+    if (g_planner == PATH_PLANNER_JPS)
+    {
+        JpsContext c = {map, layer, car_width, car_height, gx, gy};
+        return jps_search(ws, &c, sx, sy);
+    }
+
+    return astar_search(ws, map, layer, sx, sy, gx, gy, gx, gy,
+                        car_width, car_height);
+}
+
+const Path *path_find_to_rect(const struct Map *map,
+                              int sx, int sy,
+                              int gx0, int gy0, int gx1, int gy1,
+                              int car_width, int car_height)
+{
+    PathWorkspace *ws = default_workspace(map);
+    if (!ws)
+        return NULL;
+    return path_find_to_rect_ws(ws, map, sx, sy, gx0, gy0, gx1, gy1,
+                                car_width, car_height);
+}
+
+const Path *path_find_to_rect_ws(PathWorkspace *ws,
+                                 const struct Map *map,
+                                 int sx, int sy,
+                                 int gx0, int gy0, int gx1, int gy1,
+                                 int car_width, int car_height)
 {
-    p->length = 0;
+    // Clamp the goal rectangle to the map
+    if (gx0 < 0) gx0 = 0;
+    if (gy0 < 0) gy0 = 0;
+    if (gx1 >= map->width) gx1 = map->width - 1;
+    if (gy1 >= map->height) gy1 = map->height - 1;
+    if (gx0 > gx1 || gy0 > gy1)
+        return NULL;
+    if (sx < 0 || sx >= map->width || sy < 0 || sy >= map->height)
+        return NULL;
+
+    const FootprintLayer *layer = map_get_footprint(map, car_width, car_height);
+    if (!car_fits_at(map, layer, sx, sy, car_width, car_height))
+        return NULL;
+
+    return astar_search(ws, map, layer, sx, sy, gx0, gy0, gx1, gy1,
+                        car_width, car_height);
 }
 
-bool path_find(const struct Map *map,
-               int sx, int sy,
-               int gx, int gy,
-               Path *out_path)
+const Path *path_find(const struct Map *map,
+                      int sx, int sy,
+                      int gx, int gy)
 {
-    path_init(out_path);
+    PathWorkspace *ws = default_workspace(map);
+    if (!ws)
+        return NULL;
+    return path_find_ws(ws, map, sx, sy, gx, gy);
+}
 
+const Path *path_find_ws(PathWorkspace *ws,
+                         const struct Map *map,
+                         int sx, int sy,
+                         int gx, int gy)
+{
     int width = map->width;
     int height = map->height;
-    int num_cells = width * height;
 
     // Check if start/goal inside map and walkable
     if (sx < 0 || sx >= width || sy < 0 || sy >= height)
-        return false;
+        return NULL;
     if (gx < 0 || gx >= width || gy < 0 || gy >= height)
-        return false;
+        return NULL;
 
     if (!map_is_walkable(map, sx, sy))
-        return false;
+        return NULL;
     if (!map_is_walkable(map, gx, gy))
-        return false;
+        return NULL;
 
     int start_idx = IDX(sx, sy, width);
     int goal_idx = IDX(gx, gy, width);
 
     // Trivial case: start == goal
     if (start_idx == goal_idx)
-    {
-        out_path->length = 1;
-        out_path->steps[0].x = sx;
-        out_path->steps[0].y = sy;
-        return true;
-    }
-
-    // Allocate BFS buffers
-    unsigned char *visited = calloc(num_cells, sizeof(unsigned char));
-    int *came_from = malloc(num_cells * sizeof(int));
-    int *queue = malloc(num_cells * sizeof(int));
-
-    if (!visited || !came_from || !queue)
-    {
-        free(visited);
-        free(came_from);
-        free(queue);
-        return false;
-    }
-
-    // Initialize came_from with sentinel -1
-    for (int i = 0; i < num_cells; ++i)
-    {
-        came_from[i] = -1;
-    }
+        return path_single_tile(ws, sx, sy);
 
     // BFS setup
+    workspace_begin(ws);
+    int *queue = ws->queue;
     int head = 0;
     int tail = 0;
 
     queue[tail++] = start_idx;
-    visited[start_idx] = 1;
+    ws_visit(ws, start_idx, 0, -1);
 
     // 4 neighbors: E, W, N, S
     const int dx[4] = {1, -1, 0, 0};
@@ -264,73 +727,19 @@ bool path_find(const struct Map *map,
 
             int n_idx = IDX(nx, ny, width);
 
-            if (visited[n_idx])
+            if (ws_visited(ws, n_idx))
                 continue;
 
             if (!map_is_walkable(map, nx, ny))
                 continue;
 
-            visited[n_idx] = 1;
-            came_from[n_idx] = current;
+            ws_visit(ws, n_idx, ws->g_score[current] + 1, current);
             queue[tail++] = n_idx;
         }
     }
 
     if (!found)
-    {
-        // No path
-        free(visited);
-        free(came_from);
-        free(queue);
-        return false;
-    }
+        return NULL; // No path
 
-    // Reconstruct path backwards from goal_idx
-    int path_buf_len = 0;
-    int cur = goal_idx;
-
-    while (cur != -1 && cur != start_idx)
-    {
-        int x = cur % width;
-        int y = cur / width;
-
-        if (path_buf_len >= MAX_PATH_STEPS)
-        {
-            // Path too long for buffer
-            free(visited);
-            free(came_from);
-            return false;
-        }
-
-        out_path->steps[path_buf_len].x = x;
-        out_path->steps[path_buf_len].y = y;
-        path_buf_len++;
-
-        cur = came_from[cur];
-    }
-
-    // Add start tile
-    if (path_buf_len >= MAX_PATH_STEPS)
-    {
-        free(visited);
-        free(came_from);
-        return false;
-    }
-    out_path->steps[path_buf_len].x = sx;
-    out_path->steps[path_buf_len].y = sy;
-    path_buf_len++;
-
-    // Now steps are [goal, ..., start] -> reverse to [start, ..., goal]
-    for (int i = 0; i < path_buf_len / 2; ++i)
-    {
-        PathStep tmp = out_path->steps[i];
-        out_path->steps[i] = out_path->steps[path_buf_len - 1 - i];
-        out_path->steps[path_buf_len - 1 - i] = tmp;
-    }
-
-    out_path->length = path_buf_len;
-
-    free(visited);
-    free(came_from);
-    return true;
-}
\ No newline at end of file
+    return path_reconstruct(ws, width, start_idx, goal_idx);
+}
@@ -2,39 +2,156 @@
 #define PATH_H
 
 #include <stdbool.h>
-
-#define MAX_PATH_STEPS 1024
+#include <stdint.h>
+#include "path_heap.h"
+#include "../common/direction.h"
 
 struct Map;
 
+// One straight run of a path: `run` unit steps towards `dir`
+typedef struct
+{
+    uint8_t dir; // Direction
+    uint16_t run;
+} PathSegment;
+
+// A path stored as run-length segments, starting at (start_x, start_y).
+// Paths are immutable, reference counted and recycled through a shared
+// pool, so one copy is shared by the path cache and every vehicle
+// driving it. There is no length limit.
+typedef struct Path
+{
+    int start_x;
+    int start_y;
+    int length;    // tiles visited, including the start tile
+    int seg_count;
+    int refs;      // owned by path.c
+    int pool_class; // owned by path.c
+    PathSegment segs[];
+} Path;
+
+// Walks a path one tile at a time (for movement and drawing)
 typedef struct
 {
-    int x;
+    const Path *path;
+    int seg;    // segment holding the next step
+    int offset; // steps already taken inside that segment
+    int index;  // tiles passed so far, 0 = on the start tile
+    int x;      // current tile
     int y;
-} PathStep;
+} PathIter;
 
+// Collects the tiles of a path while a search writes it out
 typedef struct
 {
-    PathStep steps[MAX_PATH_STEPS];
+    int start_x;
+    int start_y;
+    int x; // last tile added
+    int y;
     int length;
-} Path;
+    int seg_count;
+    int seg_capacity;
+    PathSegment *segs;
+} PathBuilder;
+
+// Scratch buffers for searches on one map, allocated once and reused.
+// g_score/came_from entries are only valid where stamp[i] == generation,
+// so starting a new search is O(1) instead of clearing W*H arrays.
+// One workspace must not be shared between threads.
+typedef struct
+{
+    int num_cells;
+    unsigned int generation;
+    unsigned int *stamp;
+    int *g_score;
+    int *came_from;
+    int *queue; // BFS queue, also used to reverse reconstructed paths
+    PathHeap heap; // A* open list
+    PathBuilder builder;
+} PathWorkspace;
 
-// Initialize a path (sets length to 0)
-void path_init(Path *p);
+// Search used by path_find_with_size(_ws). Both return shortest paths
+// with per-tile steps; JPS skips the symmetric expansions of plain A*
+// along open aisles.
+typedef enum
+{
+    PATH_PLANNER_ASTAR,
+    PATH_PLANNER_JPS
+} PathPlanner;
+
+void path_set_planner(PathPlanner planner);
+PathPlanner path_get_planner(void);
+
+// Reference counting. Every function returning a const Path * hands one
+// reference to the caller; pass it on (e.g. vehicle_set_path) or release it.
+// Safe to call from any thread.
+const Path *path_retain(const Path *p);  // add a reference
+void path_release(const Path *p);        // drop a reference, recycles on the last one
+
+// Step delta for a segment direction
+void path_dir_delta(Direction dir, int *dx, int *dy);
+
+// Iteration
+void path_iter_init(PathIter *it, const Path *p);
+bool path_iter_has_next(const PathIter *it);
+void path_iter_peek(const PathIter *it, int *next_x, int *next_y);
+void path_iter_advance(PathIter *it);
+
+// Building
+void path_builder_init(PathBuilder *b);
+void path_builder_free(PathBuilder *b);
+void path_builder_start(PathBuilder *b, int x, int y);
+// Append the next tile; it must be a 4-neighbor of the last one
+bool path_builder_step(PathBuilder *b, int x, int y);
+// Copy the collected path into a shared Path (NULL on OOM)
+const Path *path_builder_share(const PathBuilder *b);
 
+// Allocate a workspace sized for map. Returns false on OOM.
+bool path_workspace_init(PathWorkspace *ws, const struct Map *map);
+void path_workspace_free(PathWorkspace *ws);
+
+// Total buffer allocations made for searches and paths so far. Stays
+// constant across searches once the workspaces exist and released paths
+// are being recycled by the pool.
+unsigned long path_alloc_count(void);
 
 // Find a shortest path from (sx, sy) to (gx, gy) for a car of given size and orientation.
-// Returns true on success and fills out_path with the path.
+// Returns the path (one reference for the caller) or NULL if there is none.
 // Only steps where the car's full footprint fits are allowed.
-bool path_find_with_size(const struct Map *map,
-                        int sx, int sy,
-                        int gx, int gy,
-                        int car_width, int car_height,
-                        Path *out_path);
-
-bool path_find(const struct Map *map,
-               int sx, int sy,
-               int gx, int gy,
-               Path *out_path);
+const Path *path_find_with_size(const struct Map *map,
+                                int sx, int sy,
+                                int gx, int gy,
+                                int car_width, int car_height);
+
+const Path *path_find(const struct Map *map,
+                      int sx, int sy,
+                      int gx, int gy);
+
+// Same as above but using the caller's workspace. The variants without a
+// workspace share one module-wide workspace, sized lazily for the map.
+const Path *path_find_with_size_ws(PathWorkspace *ws,
+                                   const struct Map *map,
+                                   int sx, int sy,
+                                   int gx, int gy,
+                                   int car_width, int car_height);
+
+const Path *path_find_ws(PathWorkspace *ws,
+                         const struct Map *map,
+                         int sx, int sy,
+                         int gx, int gy);
+
+// Multi-goal search: shortest path to whichever anchor inside the
+// rectangle [gx0,gx1] x [gy0,gy1] is cheapest to reach with the footprint
+// fitting, found in a single A* pass. NULL if none is reachable.
+const Path *path_find_to_rect(const struct Map *map,
+                              int sx, int sy,
+                              int gx0, int gy0, int gx1, int gy1,
+                              int car_width, int car_height);
+
+const Path *path_find_to_rect_ws(PathWorkspace *ws,
+                                 const struct Map *map,
+                                 int sx, int sy,
+                                 int gx0, int gy0, int gx1, int gy1,
+                                 int car_width, int car_height);
 
 #endif // PATH_H
@@ -0,0 +1,225 @@
+#include "path_batch.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "../common/debug.h"
+#include "../map/map.h"
+#include "flow_field.h"
+#include "path_cache.h"
+
+typedef struct
+{
+    int sx, sy;
+    int gx, gy;
+    int car_width, car_height;
+    PathBatchApply apply;
+    void *user;
+    bool cached;       // in the cache when the batch started: not planned
+    bool computed;     // result below is valid
+    const Path *result;
+} PathRequest;
+
+static PathRequest *g_requests = NULL;
+static int g_count = 0;
+static int g_capacity = 0;
+static unsigned int g_epoch = 0; // walk_epoch of the queued requests
+
+// Workers. Slot 0 of g_ws belongs to the thread calling flush.
+static pthread_t g_threads[PATH_BATCH_MAX_THREADS];
+static PathWorkspace g_ws[PATH_BATCH_MAX_THREADS + 1];
+static int g_thread_count = 0;
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_work_cv = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t g_done_cv = PTHREAD_COND_INITIALIZER;
+static unsigned long g_round = 0; // bumped for every batch handed out
+static int g_busy = 0;           // workers still on the current round
+static int g_next = 0;           // next request to plan
+static bool g_quit = false;
+static const struct Map *g_map = NULL;
+
+// Plan requests until none are left (called by every thread of a round)
+static void batch_drain(PathWorkspace *ws)
+{
+    for (;;)
+    {
+        pthread_mutex_lock(&g_lock);
+        int i = g_next++;
+        pthread_mutex_unlock(&g_lock);
+        if (i >= g_count)
+            return;
+
+        PathRequest *r = &g_requests[i];
+        if (r->cached)
+            continue;
+        r->result = flow_field_find_path_ws(ws, g_map, r->sx, r->sy, r->gx, r->gy,
+                                            r->car_width, r->car_height);
+        r->computed = true;
+    }
+}
+
+static void *batch_worker(void *arg)
+{
+    PathWorkspace *ws = arg;
+    unsigned long seen = 0;
+    pthread_mutex_lock(&g_lock);
+    for (;;)
+    {
+        while (!g_quit && g_round == seen)
+            pthread_cond_wait(&g_work_cv, &g_lock);
+        if (g_quit)
+            break;
+        seen = g_round;
+        pthread_mutex_unlock(&g_lock);
+
+        batch_drain(ws);
+
+        pthread_mutex_lock(&g_lock);
+        if (--g_busy == 0)
+            pthread_cond_signal(&g_done_cv);
+    }
+    pthread_mutex_unlock(&g_lock);
+    return NULL;
+}
+
+bool path_batch_start(int threads)
+{
+    path_batch_stop();
+    if (threads > PATH_BATCH_MAX_THREADS)
+        threads = PATH_BATCH_MAX_THREADS;
+    if (threads <= 1)
+        return true;
+
+    g_quit = false;
+    // The calling thread plans too, so start one worker less
+    for (int i = 0; i < threads - 1; ++i)
+    {
+        if (pthread_create(&g_threads[i], NULL, batch_worker, &g_ws[i + 1]) != 0)
+            break;
+        g_thread_count++;
+    }
+    debug_log("[path] Batch planning on %d threads\n", g_thread_count + 1);
+    return g_thread_count > 0;
+}
+
+void path_batch_stop(void)
+{
+    pthread_mutex_lock(&g_lock);
+    g_quit = true;
+    pthread_cond_broadcast(&g_work_cv);
+    pthread_mutex_unlock(&g_lock);
+    for (int i = 0; i < g_thread_count; ++i)
+        pthread_join(g_threads[i], NULL);
+    g_thread_count = 0;
+    g_quit = false;
+
+    for (int i = 0; i <= PATH_BATCH_MAX_THREADS; ++i)
+        path_workspace_free(&g_ws[i]);
+    free(g_requests);
+    g_requests = NULL;
+    g_count = 0;
+    g_capacity = 0;
+}
+
+void path_batch_add(const struct Map *map,
+                    int sx, int sy,
+                    int gx, int gy,
+                    int car_width, int car_height,
+                    PathBatchApply apply, void *user)
+{
+    if (g_count > 0 && g_epoch != map->walk_epoch)
+    {
+        // Queued requests were meant for the old walkability; better late
+        // than planned against the wrong map
+        debug_log("[path] Map changed with %d requests queued; flushing\n", g_count);
+        path_batch_flush(map);
+    }
+    g_epoch = map->walk_epoch;
+
+    if (g_count == g_capacity)
+    {
+        int cap = g_capacity ? g_capacity * 2 : 32;
+        PathRequest *grown = realloc(g_requests, cap * sizeof(PathRequest));
+        if (!grown)
+        {
+            apply(user, path_cache_find(map, sx, sy, gx, gy, car_width, car_height));
+            return;
+        }
+        g_requests = grown;
+        g_capacity = cap;
+    }
+    g_requests[g_count++] = (PathRequest){sx, sy, gx, gy, car_width, car_height,
+                                          apply, user, false, false, NULL};
+}
+
+void path_batch_flush(const struct Map *map)
+{
+    if (g_count == 0)
+        return;
+
+    // Serial prologue: skip what the cache already has and bring the
+    // flow fields up to date, in request order (same field slots as a
+    // serial run would take)
+    int pending = 0;
+    for (int i = 0; i < g_count; ++i)
+    {
+        PathRequest *r = &g_requests[i];
+        r->cached = path_cache_contains(map, r->sx, r->sy, r->gx, r->gy, r->car_width, r->car_height);
+        if (r->cached)
+            continue;
+        flow_field_prepare(map, r->gx, r->gy, r->car_width, r->car_height);
+        pending++;
+    }
+
+    if (pending > 0)
+    {
+        int num_cells = map->width * map->height;
+        bool ready = true;
+        for (int i = 0; i <= g_thread_count; ++i)
+        {
+            if (g_ws[i].num_cells != num_cells)
+            {
+                path_workspace_free(&g_ws[i]);
+                ready = path_workspace_init(&g_ws[i], map) && ready;
+            }
+        }
+
+        g_map = map;
+        g_next = 0;
+        if (!ready)
+        {
+            // Out of memory: leave everything to path_cache_resolve below
+        }
+        else if (g_thread_count > 0 && pending > 1)
+        {
+            pthread_mutex_lock(&g_lock);
+            g_busy = g_thread_count;
+            g_round++;
+            pthread_cond_broadcast(&g_work_cv);
+            pthread_mutex_unlock(&g_lock);
+
+            batch_drain(&g_ws[0]);
+
+            pthread_mutex_lock(&g_lock);
+            while (g_busy > 0)
+                pthread_cond_wait(&g_done_cv, &g_lock);
+            pthread_mutex_unlock(&g_lock);
+        }
+        else
+        {
+            batch_drain(&g_ws[0]);
+        }
+        g_map = NULL;
+    }
+
+    // Apply in request order
+    for (int i = 0; i < g_count; ++i)
+    {
+        PathRequest *r = &g_requests[i];
+        const Path *p = path_cache_resolve(map, r->sx, r->sy, r->gx, r->gy,
+                                           r->car_width, r->car_height,
+                                           r->computed, r->result);
+        r->apply(r->user, p);
+    }
+    g_count = 0;
+}
@@ -0,0 +1,35 @@
+#ifndef PATH_BATCH_H
+#define PATH_BATCH_H
+
+#include <stdbool.h>
+#include "path.h"
+
+struct Map;
+
+#define PATH_BATCH_MAX_THREADS 16
+
+// Receives the result of one batched request (one reference, may be NULL)
+typedef void (*PathBatchApply)(void *user, const Path *path);
+
+// Start `threads` planning workers (0 or 1 = plan on the calling thread).
+// Returns false if no worker could be started; batches still work then.
+bool path_batch_start(int threads);
+void path_batch_stop(void);
+
+// Queue a path_cache_find-style request. Nothing is planned until
+// path_batch_flush; the map's walkability must not change in between.
+void path_batch_add(const struct Map *map,
+                    int sx, int sy,
+                    int gx, int gy,
+                    int car_width, int car_height,
+                    PathBatchApply apply, void *user);
+
+// Plan every queued request and hand the results to their callbacks in
+// the order they were added. Misses are searched on the workers, each
+// with its own workspace, against flow fields prepared up front; the
+// cache is consulted and filled on the calling thread while applying, so
+// results and cache statistics do not depend on the number of threads.
+// Callbacks must not queue new requests.
+void path_batch_flush(const struct Map *map);
+
+#endif // PATH_BATCH_H
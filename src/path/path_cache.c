@@ -0,0 +1,127 @@
+#include "path_cache.h"
+
+#include <stdlib.h>
+
+#include "../map/map.h"
+#include "flow_field.h"
+
+typedef struct
+{
+    int used;
+    int sx, sy;
+    int gx, gy;
+    int car_width, car_height;
+    unsigned int walk_key;
+    const Path *path; // NULL = cached "no route"
+    unsigned long last_used;
+} PathCacheEntry;
+
+static PathCacheEntry g_entries[PATH_CACHE_SIZE];
+static unsigned long g_clock = 0;
+static unsigned long g_hits = 0;
+static unsigned long g_misses = 0;
+
+static void entry_drop(PathCacheEntry *e)
+{
+    path_release(e->path);
+    e->path = NULL;
+    e->used = 0;
+}
+
+// Free slot, else the least recently used
+static PathCacheEntry *cache_victim(void)
+{
+    PathCacheEntry *victim = &g_entries[0];
+    for (int i = 0; i < PATH_CACHE_SIZE; ++i)
+    {
+        PathCacheEntry *e = &g_entries[i];
+        if (!e->used)
+            return e;
+        if (e->last_used < victim->last_used)
+            victim = e;
+    }
+    return victim;
+}
+
+static PathCacheEntry *cache_lookup(unsigned int walk_key,
+                                    int sx, int sy, int gx, int gy,
+                                    int car_width, int car_height)
+{
+    for (int i = 0; i < PATH_CACHE_SIZE; ++i)
+    {
+        PathCacheEntry *e = &g_entries[i];
+        if (e->used && e->walk_key == walk_key &&
+            e->sx == sx && e->sy == sy && e->gx == gx && e->gy == gy &&
+            e->car_width == car_width && e->car_height == car_height)
+            return e;
+    }
+    return NULL;
+}
+
+const Path *path_cache_find(const struct Map *map,
+                            int sx, int sy,
+                            int gx, int gy,
+                            int car_width, int car_height)
+{
+    return path_cache_resolve(map, sx, sy, gx, gy, car_width, car_height, false, NULL);
+}
+
+bool path_cache_contains(const struct Map *map,
+                         int sx, int sy,
+                         int gx, int gy,
+                         int car_width, int car_height)
+{
+    return cache_lookup(map_walk_key(map), sx, sy, gx, gy, car_width, car_height) != NULL;
+}
+
+const Path *path_cache_resolve(const struct Map *map,
+                               int sx, int sy,
+                               int gx, int gy,
+                               int car_width, int car_height,
+                               bool computed, const Path *result)
+{
+    unsigned int walk_key = map_walk_key(map);
+    g_clock++;
+
+    PathCacheEntry *hit = cache_lookup(walk_key, sx, sy, gx, gy, car_width, car_height);
+    if (hit)
+    {
+        hit->last_used = g_clock;
+        g_hits++;
+        path_release(result);
+        return path_retain(hit->path);
+    }
+
+    g_misses++;
+    const Path *shared = computed ? result
+                                  : flow_field_find_path(map, sx, sy, gx, gy, car_width, car_height);
+
+    PathCacheEntry *e = cache_victim();
+    entry_drop(e);
+    e->used = 1;
+    e->sx = sx;
+    e->sy = sy;
+    e->gx = gx;
+    e->gy = gy;
+    e->car_width = car_width;
+    e->car_height = car_height;
+    e->walk_key = walk_key;
+    e->path = shared; // the cache's reference
+    e->last_used = g_clock;
+
+    return path_retain(shared);
+}
+
+void path_cache_stats(unsigned long *hits, unsigned long *misses)
+{
+    if (hits)
+        *hits = g_hits;
+    if (misses)
+        *misses = g_misses;
+}
+
+void path_cache_clear(void)
+{
+    for (int i = 0; i < PATH_CACHE_SIZE; ++i)
+        entry_drop(&g_entries[i]);
+}
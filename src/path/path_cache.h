@@ -0,0 +1,46 @@
+#ifndef PATH_CACHE_H
+#define PATH_CACHE_H
+
+#include <stdbool.h>
+#include "path.h"
+
+struct Map;
+
+#define PATH_CACHE_SIZE 64
+
+// Shortest path from (sx,sy) to (gx,gy) for a car_width x car_height
+// footprint, memoized in an LRU cache keyed by start, goal, footprint and
+// the map's walkability key (gate states). The epoch counter only grows,
+// but gates keep cycling through the same few states, so keying on the
+// state lets a path found with the gate open be reused the next time it is.
+// Misses are resolved with flow_field_find_path. Returns a shared,
+// read-only path with one reference owned by the caller (release it or
+// hand it to vehicle_set_path), or NULL if the goal is unreachable.
+const Path *path_cache_find(const struct Map *map,
+                            int sx, int sy,
+                            int gx, int gy,
+                            int car_width, int car_height);
+
+// True if the path is cached (no effect on LRU order or counters)
+bool path_cache_contains(const struct Map *map,
+                         int sx, int sy,
+                         int gx, int gy,
+                         int car_width, int car_height);
+
+// path_cache_find with the miss already resolved by the caller: when
+// `computed` is set, `result` (one reference, may be NULL) is used on a
+// miss instead of searching, and released on a hit. Hit/miss accounting
+// and LRU order are exactly those of path_cache_find.
+const Path *path_cache_resolve(const struct Map *map,
+                               int sx, int sy,
+                               int gx, int gy,
+                               int car_width, int car_height,
+                               bool computed, const Path *result);
+
+// Lookup counters since start
+void path_cache_stats(unsigned long *hits, unsigned long *misses);
+
+// Drop all cached paths (vehicles keep their own references)
+void path_cache_clear(void);
+
+#endif // PATH_CACHE_H
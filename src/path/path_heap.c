@@ -0,0 +1,112 @@
+#include "path_heap.h"
+
+#include <stdlib.h>
+
+static int heap_less(const PathHeapNode *a, const PathHeapNode *b)
+{
+    if (a->f != b->f)
+        return a->f < b->f;
+    return a->h < b->h;
+}
+
+static void heap_place(PathHeap *h, int slot, PathHeapNode node)
+{
+    h->nodes[slot] = node;
+    h->pos[node.idx] = slot;
+}
+
+static void heap_sift_up(PathHeap *h, int slot)
+{
+    PathHeapNode node = h->nodes[slot];
+    while (slot > 0)
+    {
+        int parent = (slot - 1) / 2;
+        if (!heap_less(&node, &h->nodes[parent]))
+            break;
+        heap_place(h, slot, h->nodes[parent]);
+        slot = parent;
+    }
+    heap_place(h, slot, node);
+}
+
+static void heap_sift_down(PathHeap *h, int slot)
+{
+    PathHeapNode node = h->nodes[slot];
+    for (;;)
+    {
+        int child = 2 * slot + 1;
+        if (child >= h->size)
+            break;
+        if (child + 1 < h->size && heap_less(&h->nodes[child + 1], &h->nodes[child]))
+            child++;
+        if (!heap_less(&h->nodes[child], &node))
+            break;
+        heap_place(h, slot, h->nodes[child]);
+        slot = child;
+    }
+    heap_place(h, slot, node);
+}
+
+bool path_heap_init(PathHeap *h, int num_cells)
+{
+    h->nodes = malloc(num_cells * sizeof(PathHeapNode));
+    h->pos = malloc(num_cells * sizeof(int));
+    h->size = 0;
+    h->capacity = num_cells;
+    if (!h->nodes || !h->pos)
+    {
+        path_heap_free(h);
+        return false;
+    }
+    for (int i = 0; i < num_cells; ++i)
+        h->pos[i] = -1;
+    return true;
+}
+
+void path_heap_free(PathHeap *h)
+{
+    free(h->nodes);
+    free(h->pos);
+    h->nodes = NULL;
+    h->pos = NULL;
+    h->size = 0;
+    h->capacity = 0;
+}
+
+void path_heap_clear(PathHeap *h)
+{
+    for (int i = 0; i < h->size; ++i)
+        h->pos[h->nodes[i].idx] = -1;
+    h->size = 0;
+}
+
+void path_heap_push(PathHeap *h, int idx, int f, int hcost)
+{
+    PathHeapNode node = {idx, f, hcost};
+    int slot = h->pos[idx];
+    if (slot >= 0)
+    {
+        // Decrease-key: only ever improve an entry
+        if (!heap_less(&node, &h->nodes[slot]))
+            return;
+        h->nodes[slot] = node;
+        heap_sift_up(h, slot);
+        return;
+    }
+    slot = h->size++;
+    h->nodes[slot] = node;
+    heap_sift_up(h, slot);
+}
+
+PathHeapNode path_heap_pop(PathHeap *h)
+{
+    PathHeapNode top = h->nodes[0];
+    h->pos[top.idx] = -1;
+    h->size--;
+    if (h->size > 0)
+    {
+        h->nodes[0] = h->nodes[h->size];
+        heap_sift_down(h, 0);
+    }
+    return top;
+}
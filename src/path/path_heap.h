@@ -0,0 +1,48 @@
+#ifndef PATH_HEAP_H
+#define PATH_HEAP_H
+
+#include <stdbool.h>
+
+// One entry of the A* open list
+typedef struct
+{
+    int idx; // flat cell index
+    int f;   // total cost = g + h
+    int h;   // heuristic, used to break ties on f
+} PathHeapNode;
+
+// Indexed binary min-heap over flat cell indices.
+// pos[] maps a cell to its slot in nodes[] (-1 = not queued), which gives
+// O(log n) push, pop and decrease-key.
+typedef struct
+{
+    PathHeapNode *nodes;
+    int *pos;
+    int size;
+    int capacity; // number of cells
+} PathHeap;
+
+// Allocate a heap for up to num_cells cells. Returns false on OOM.
+bool path_heap_init(PathHeap *h, int num_cells);
+void path_heap_free(PathHeap *h);
+
+// Empty the heap. Only touches the cells still queued.
+void path_heap_clear(PathHeap *h);
+
+static inline bool path_heap_empty(const PathHeap *h)
+{
+    return h->size == 0;
+}
+
+static inline bool path_heap_contains(const PathHeap *h, int idx)
+{
+    return h->pos[idx] >= 0;
+}
+
+// Insert idx, or lower its key if it is already queued with a worse one
+void path_heap_push(PathHeap *h, int idx, int f, int hcost);
+
+// Remove and return the node with the smallest f (ties: smallest h)
+PathHeapNode path_heap_pop(PathHeap *h);
+
+#endif // PATH_HEAP_H
@@ -1,198 +1,714 @@
+#define _GNU_SOURCE
 #include "../common/debug.h"
 #include "render.h"
 
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
 
-static void clear_screen(void)
+// A resolved cell: what the terminal shows at a tile. Plain cells are
+// the buffer char; overlays that do not come from the buffer get a code
+// of their own past the chars.
+#define CELL_SPOT_FREE 0x100
+#define CELL_SPOT_TAKEN 0x101
+#define CELL_GATE_OPEN 0x102
+#define CELL_GATE_CLOSED 0x103
+#define CELL_KINDS 0x104
+#define CELL_UNKNOWN 0xFFFF // never drawn: always differs
+
+// SGR colour per cell, 0 = terminal default
+#define COLOR_DEFAULT 0
+#define COLOR_RED 31
+#define COLOR_GREY 90
+#define COLOR_BRIGHT_GREEN 92
+
+typedef struct
+{
+    char glyph[4]; // UTF-8
+    uint8_t len;
+    uint8_t color;
+} CellStyle;
+
+static CellStyle g_styles[CELL_KINDS];
+static bool g_styles_ready = false;
+
+// Bumped by SIGWINCH; every Screen refits its view when it sees a new count
+static volatile sig_atomic_t g_resize_count = 0;
+static bool g_resize_watched = false;
+
+// Longest output of one cell: cursor move, colour switch, glyph
+#define CELL_MAX_BYTES (sizeof("\033[65535;65535H") + sizeof("\033[99m") + 4)
+// Frame prologue (clear) and epilogue (colour reset, move, clear below)
+#define FRAME_EXTRA_BYTES 64
+
+static void style_set(int cell, const char *glyph, uint8_t color)
+{
+    size_t len = strlen(glyph);
+    memcpy(g_styles[cell].glyph, glyph, len);
+    g_styles[cell].len = (uint8_t)len;
+    g_styles[cell].color = color;
+}
+
+static void styles_init(void)
+{
+    if (g_styles_ready)
+        return;
+    for (int c = 0; c < 256; ++c)
+    {
+        g_styles[c].glyph[0] = (char)c;
+        g_styles[c].len = 1;
+        g_styles[c].color = COLOR_DEFAULT;
+    }
+    style_set('_', "─", COLOR_DEFAULT);
+    style_set('|', "│", COLOR_DEFAULT);
+    style_set('R', "┌", COLOR_DEFAULT);
+    style_set('T', "┐", COLOR_DEFAULT);
+    style_set('L', "└", COLOR_DEFAULT);
+    style_set('J', "┘", COLOR_DEFAULT);
+    style_set('+', "┼", COLOR_DEFAULT);
+    style_set('*', "*", COLOR_GREY);
+    style_set(CELL_SPOT_FREE, "│", COLOR_BRIGHT_GREEN);
+    style_set(CELL_SPOT_TAKEN, "|", COLOR_RED);
+    style_set(CELL_GATE_OPEN, " ", COLOR_DEFAULT);
+    style_set(CELL_GATE_CLOSED, "│", COLOR_DEFAULT);
+    g_styles_ready = true;
+}
+
+static void on_resize(int sig)
+{
+    (void)sig;
+    g_resize_count++;
+}
+
+static void resize_watch(void)
 {
-    printf("\033[2J\033[H");
+    if (g_resize_watched)
+        return;
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_resize;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGWINCH, &sa, NULL);
+    g_resize_watched = true;
+}
+
+// Move the view to (x,y), kept within the map
+static void view_move(Screen *s, int x, int y)
+{
+    if (x > s->width - s->view_w)
+        x = s->width - s->view_w;
+    if (y > s->height - s->view_h)
+        y = s->height - s->view_h;
+    if (x < 0)
+        x = 0;
+    if (y < 0)
+        y = 0;
+    if (x != s->view_x || y != s->view_y)
+    {
+        s->view_x = x;
+        s->view_y = y;
+        s->view_moved = true;
+    }
+}
+
+// Size the view to the terminal: the whole map if it fits or the size is
+// unknown, leaving SCREEN_TEXT_ROWS lines below it
+static void view_fit(Screen *s)
+{
+    struct winsize w;
+    s->resize_seen = g_resize_count;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) != 0 || w.ws_row == 0 || w.ws_col == 0)
+    {
+        s->term_rows = 0;
+        s->view_w = s->width;
+        s->view_h = s->height;
+    }
+    else
+    {
+        s->term_rows = w.ws_row;
+        int rows = w.ws_row - SCREEN_TEXT_ROWS;
+        s->view_w = w.ws_col < s->width ? w.ws_col : s->width;
+        s->view_h = rows < 1 ? 1 : rows < s->height ? rows : s->height;
+    }
+    view_move(s, s->view_x, s->view_y);
 }
 
 int screen_init(Screen *s, const Map *map)
 {
+    memset(s, 0, sizeof(*s));
     s->width = map->width;
     s->height = map->height;
 
-    s->buffer = malloc(s->height * sizeof(char *));
-    if (!s->buffer)
+    int cells = s->width * s->height;
+    s->background = malloc(cells);
+    s->buffer = malloc(cells);
+    s->path_marks = calloc(cells, sizeof(unsigned int));
+    s->dirty_stamp = calloc(cells, sizeof(unsigned int));
+    s->span_x0 = malloc(s->height * sizeof(int));
+    s->span_x1 = malloc(s->height * sizeof(int));
+    s->front = malloc(cells * sizeof(uint16_t));
+    s->overlay = calloc(cells, sizeof(uint16_t));
+    s->out_capacity = (size_t)cells * CELL_MAX_BYTES + FRAME_EXTRA_BYTES;
+    s->out = malloc(s->out_capacity);
+    if (!s->background || !s->buffer || !s->path_marks || !s->dirty_stamp ||
+        !s->span_x0 || !s->span_x1 || !s->front || !s->overlay || !s->out)
+    {
+        screen_free(s);
         return 0;
+    }
+    memset(s->background, ' ', cells);
+    memset(s->buffer, ' ', cells);
+    styles_init();
+    s->follow_slot = -1;
+    resize_watch();
+    view_fit(s);
+    screen_invalidate(s);
+    s->all_dirty = true;
+    return 1;
+}
 
-    for (int y = 0; y < s->height; ++y)
+int screen_lines_below(const Screen *s)
+{
+    if (s->term_rows == 0)
+        return INT_MAX;
+    return s->term_rows > s->view_h ? s->term_rows - s->view_h : 0;
+}
+
+void screen_pan(Screen *s, int dx, int dy)
+{
+    s->follow_slot = -1;
+    view_move(s, s->view_x + dx, s->view_y + dy);
+}
+
+void screen_follow(Screen *s, int slot, uint32_t generation)
+{
+    s->follow_slot = slot;
+    s->follow_generation = generation;
+}
+
+// Scroll so the followed vehicle stays a quarter of the view away from
+// its edges; stop following once it is gone
+static void view_follow(Screen *s)
+{
+    if (s->follow_slot < 0)
+        return;
+    const ScreenVehicle *d = s->follow_slot < s->drawn_capacity ? &s->drawn[s->follow_slot] : NULL;
+    if (!d || d->generation != s->follow_generation || d->seen != s->frame)
     {
-        s->buffer[y] = malloc(s->width * sizeof(char));
-        if (!s->buffer[y])
-        {
-            for (int k = 0; k < y; ++k)
-                free(s->buffer[k]);
-            free(s->buffer);
-            s->buffer = NULL;
-            return 0;
-        }
+        s->follow_slot = -1;
+        return;
     }
-    return 1;
+    int x0 = d->x, y0 = d->y, x1 = d->x + 1, y1 = d->y + 1;
+    if (d->spr)
+    {
+        x0 += d->spr->min_x;
+        y0 += d->spr->min_y;
+        x1 = d->x + d->spr->max_x + 1;
+        y1 = d->y + d->spr->max_y + 1;
+    }
+    int mx = s->view_w / 4;
+    int my = s->view_h / 4;
+    int vx = s->view_x;
+    int vy = s->view_y;
+    if (x1 > vx + s->view_w - mx)
+        vx = x1 - s->view_w + mx;
+    if (x0 < vx + mx)
+        vx = x0 - mx;
+    if (y1 > vy + s->view_h - my)
+        vy = y1 - s->view_h + my;
+    if (y0 < vy + my)
+        vy = y0 - my;
+    view_move(s, vx, vy);
+}
+
+void screen_invalidate(Screen *s)
+{
+    for (int i = 0; i < s->width * s->height; ++i)
+        s->front[i] = CELL_UNKNOWN;
+    s->front_valid = false;
+    s->overlay_valid = false;
 }
 
 void screen_free(Screen *s)
 {
-    if (!s || !s->buffer)
+    if (!s)
         return;
 
-    for (int y = 0; y < s->height; ++y)
-        free(s->buffer[y]);
+    for (int i = 0; i < s->drawn_capacity; ++i)
+    {
+        if (s->drawn[i].generation)
+            path_release(s->drawn[i].path_it.path);
+    }
+    free(s->drawn);
+    free(s->background);
+    free(s->path_marks);
     free(s->buffer);
-    s->buffer = NULL;
-    s->width = s->height = 0;
+    free(s->dirty_stamp);
+    free(s->dirty);
+    free(s->span_x0);
+    free(s->span_x1);
+    free(s->front);
+    free(s->overlay);
+    free(s->indicators);
+    free(s->out);
+    memset(s, 0, sizeof(*s));
 }
 
-void screen_from_map(Screen *s, const Map *map)
+int screen_from_map(Screen *s, const Map *map)
 {
+    int count = 0;
+    for (int y = 0; y < map->height; ++y)
+    {
+        for (int x = 0; x < map->width; ++x)
+        {
+            s->background[y * s->width + x] = map->tiles[y][x].symbol;
+            if (map->tiles[y][x].type == TILE_PARKING_INDICATOR)
+                count++;
+        }
+    }
+    free(s->indicators);
+    s->indicators = malloc((count ? count : 1) * sizeof(int));
+    s->indicator_count = 0;
+    if (!s->indicators)
+        return 0;
     for (int y = 0; y < map->height; ++y)
     {
         for (int x = 0; x < map->width; ++x)
         {
-            s->buffer[y][x] = map->tiles[y][x].symbol;
+            if (map->tiles[y][x].type == TILE_PARKING_INDICATOR)
+                s->indicators[s->indicator_count++] = y * s->width + x;
         }
     }
+    s->overlay_valid = false;
+    s->all_dirty = true;
+    return 1;
 }
 
-void screen_draw_vehicle(Screen *s, const Vehicle *v, const Map *map)
+// Queue tiles [x0,x1) x [y0,y1) for recompositing and presenting
+static void mark_dirty(Screen *s, int x0, int y0, int x1, int y1)
 {
-    (void)map; // not needed right now, maybe later
-
-    const Sprite *spr = vehicle_get_sprite(v);
-    if (!spr)
+    if (x0 < 0)
+        x0 = 0;
+    if (y0 < 0)
+        y0 = 0;
+    if (x1 > s->width)
+        x1 = s->width;
+    if (y1 > s->height)
+        y1 = s->height;
+    if (x0 >= x1 || y0 >= y1 || s->all_dirty)
         return;
 
-    for (int sy = 0; sy < spr->height; ++sy)
+    // Path steps come in one tile at a time: extend a run on the same row
+    if (s->dirty_count > 0)
     {
-        for (int sx = 0; sx < spr->width; ++sx)
+        ScreenRect *last = &s->dirty[s->dirty_count - 1];
+        if (last->y0 == y0 && last->y1 == y1 && last->x1 == x0)
         {
-            char c = spr->rows[sy][sx];
-            if (c == ' ')
-                continue;
+            last->x1 = x1;
+            return;
+        }
+    }
+    if (s->dirty_count == s->dirty_capacity)
+    {
+        int cap = s->dirty_capacity ? s->dirty_capacity * 2 : 64;
+        ScreenRect *grown = realloc(s->dirty, cap * sizeof(ScreenRect));
+        if (!grown)
+        {
+            s->all_dirty = true; // recomposite everything instead
+            return;
+        }
+        s->dirty = grown;
+        s->dirty_capacity = cap;
+    }
+    s->dirty[s->dirty_count++] = (ScreenRect){x0, y0, x1, y1};
+}
 
-            int tx = v->x + sx;
-            int ty = v->y + sy;
-            if (tx >= 0 && tx < s->width &&
-                ty >= 0 && ty < s->height)
-            {
-                s->buffer[ty][tx] = c;
-            }
+// Opaque bounding box of spr anchored at (x,y)
+static void mark_sprite_dirty(Screen *s, const Sprite *spr, int x, int y)
+{
+    mark_dirty(s, x + spr->min_x, y + spr->min_y, x + spr->max_x + 1, y + spr->max_y + 1);
+}
+
+// Add delta to the path marks of the steps after it, up to step index
+// `until` (-1 = to the end of the path)
+static void path_marks_apply(Screen *s, PathIter it, int until, int delta)
+{
+    while (path_iter_has_next(&it) && (until < 0 || it.index < until))
+    {
+        path_iter_advance(&it);
+        if (it.x < 0 || it.x >= s->width || it.y < 0 || it.y >= s->height)
+            continue;
+        int i = it.y * s->width + it.x;
+        bool was_marked = s->path_marks[i] > 0;
+        s->path_marks[i] += delta;
+        // Marks only show on empty background
+        if (was_marked != (s->path_marks[i] > 0) && s->background[i] == ' ')
+            mark_dirty(s, it.x, it.y, it.x + 1, it.y + 1);
+    }
+}
+
+// Take a drawn vehicle off the layers
+static void drawn_erase(Screen *s, ScreenVehicle *d)
+{
+    if (d->spr)
+        mark_sprite_dirty(s, d->spr, d->x, d->y);
+    path_marks_apply(s, d->path_it, -1, -1);
+    path_release(d->path_it.path);
+    memset(d, 0, sizeof(*d));
+}
+
+static bool drawn_reserve(Screen *s, int slot)
+{
+    if (slot < s->drawn_capacity)
+        return true;
+    int cap = s->drawn_capacity ? s->drawn_capacity : VEHICLE_POOL_CHUNK;
+    while (cap <= slot)
+        cap *= 2;
+    ScreenVehicle *grown = realloc(s->drawn, cap * sizeof(ScreenVehicle));
+    if (!grown)
+        return false;
+    memset(grown + s->drawn_capacity, 0, (cap - s->drawn_capacity) * sizeof(ScreenVehicle));
+    s->drawn = grown;
+    s->drawn_capacity = cap;
+    return true;
+}
+
+// Bring one vehicle's layers up to date
+static void drawn_sync(Screen *s, ScreenVehicle *d, const SnapVehicle *v)
+{
+    const Sprite *spr = v->spr;
+    if (spr != d->spr || v->x != d->x || v->y != d->y)
+    {
+        if (d->spr)
+            mark_sprite_dirty(s, d->spr, d->x, d->y);
+        if (spr)
+            mark_sprite_dirty(s, spr, v->x, v->y);
+        d->spr = spr;
+        d->x = v->x;
+        d->y = v->y;
+    }
+
+    const PathIter *it = &v->path_it;
+    if (it->path != d->path_it.path || it->index < d->path_it.index)
+    {
+        // New path: swap the marks
+        path_marks_apply(s, d->path_it, -1, -1);
+        path_release(d->path_it.path);
+        path_marks_apply(s, *it, -1, 1);
+        d->path_it = *it;
+        path_retain(it->path);
+    }
+    else if (it->index > d->path_it.index)
+    {
+        // Moved along: unmark the steps passed
+        path_marks_apply(s, d->path_it, it->index, -1);
+        d->path_it = *it;
+    }
+}
+
+// Background and path marks into the buffer for [x0,x1) x [y0,y1)
+static void compose_rect(Screen *s, int x0, int y0, int x1, int y1)
+{
+    for (int y = y0; y < y1; ++y)
+    {
+        for (int x = x0; x < x1; ++x)
+        {
+            int i = y * s->width + x;
+            char c = s->background[i];
+            if (c == ' ' && s->path_marks[i] > 0)
+                c = '*';
+            s->buffer[i] = c;
+            s->dirty_stamp[i] = s->frame;
         }
     }
 }
 
-void screen_present(const Screen *s, const Map *map, int step)
+// Rebuild the dirty tiles from the layers. Vehicles are drawn in spawn
+// order as before, later ones on top, but only onto dirty tiles.
+static void compose(Screen *s, const SimSnapshot *snap)
 {
-    clear_screen();
-    debug_log("Step: %d\n", step);
+    unsigned int frame = s->frame;
+    // Union of the dirty rects, to skip vehicles quickly
+    int ux0 = 0, uy0 = 0, ux1 = s->width, uy1 = s->height;
+    if (s->all_dirty)
+    {
+        compose_rect(s, 0, 0, s->width, s->height);
+    }
+    else
+    {
+        ux0 = s->width;
+        uy0 = s->height;
+        ux1 = uy1 = 0;
+        for (int r = 0; r < s->dirty_count; ++r)
+        {
+            const ScreenRect *rc = &s->dirty[r];
+            compose_rect(s, rc->x0, rc->y0, rc->x1, rc->y1);
+            if (rc->x0 < ux0)
+                ux0 = rc->x0;
+            if (rc->y0 < uy0)
+                uy0 = rc->y0;
+            if (rc->x1 > ux1)
+                ux1 = rc->x1;
+            if (rc->y1 > uy1)
+                uy1 = rc->y1;
+        }
+    }
 
-    for (int y = 0; y < s->height; ++y)
+    for (int i = 0; i < snap->vehicle_count; ++i)
     {
-        for (int x = 0; x < s->width; ++x)
+        const SnapVehicle *v = &snap->vehicles[i];
+        const Sprite *spr = v->spr;
+        if (!spr || v->x + spr->max_x < ux0 || v->x + spr->min_x >= ux1 ||
+            v->y + spr->max_y < uy0 || v->y + spr->min_y >= uy1)
+            continue;
+        for (int k = 0; k < spr->cell_count; ++k)
         {
-            // Parking Indicator Logic
-            Tile *t = &map->tiles[y][x];
-            if (t->type == TILE_PARKING_INDICATOR)
+            const SpriteCell *c = &spr->cells[k];
+            int tx = v->x + c->dx;
+            int ty = v->y + c->dy;
+            if (tx >= 0 && tx < s->width && ty >= 0 && ty < s->height &&
+                s->dirty_stamp[ty * s->width + tx] == frame)
             {
-                ParkingSpot *spot = t->spot;
-                // Only show red if spot is occupied AND the occupant is actually parked
-                int is_really_parked = 0;
-                if (spot && spot->occupied && spot->occupant && spot->occupant->state == VEH_PARKED)
-                    is_really_parked = 1;
-                if (is_really_parked)
-                    printf("\033[31m|\033[0m"); // red
-                else
-                    printf("\033[92m│\033[0m"); // bright green
-
-                continue;
+                s->buffer[ty * s->width + tx] = c->glyph;
             }
+        }
+    }
+}
 
-            // Gate rendering: check if this tile is part of a gate (render before map buffer)
-            int is_gate_tile = 0;
-            int gate_open = 1;
-            // Check entry gate
-            for (int ti = 0; ti < map->gate_entry.tile_count; ++ti) {
-                if (map->gate_entry.xs[ti] == x && map->gate_entry.ys[ti] == y) {
-                    is_gate_tile = 1;
-                    gate_open = map->gate_entry.open;
-                    break;
-                }
-            }
-            // Check exit gate (if not already found)
-            if (!is_gate_tile) {
-                for (int ti = 0; ti < map->gate_exit.tile_count; ++ti) {
-                    if (map->gate_exit.xs[ti] == x && map->gate_exit.ys[ti] == y) {
-                        is_gate_tile = 1;
-                        gate_open = map->gate_exit.open;
-                        break;
-                    }
-                }
-            }
-            if (is_gate_tile) {
-                if (gate_open)
-                    putchar(' ');
-                else
-                    printf("│");
+void screen_update(Screen *s, const SimSnapshot *snap)
+{
+    s->frame++;
+    if (s->resize_seen != g_resize_count)
+    {
+        // The terminal reflows on resize: start over on a clear screen
+        view_fit(s);
+        screen_invalidate(s);
+    }
+    for (int i = 0; i < snap->vehicle_count; ++i)
+    {
+        const SnapVehicle *v = &snap->vehicles[i];
+        if (!drawn_reserve(s, v->slot))
+            continue; // out of memory: the vehicle is not shown
+        ScreenVehicle *d = &s->drawn[v->slot];
+        if (d->generation != v->generation)
+        {
+            // Slot reused since it was drawn
+            if (d->generation)
+                drawn_erase(s, d);
+            d->generation = v->generation;
+        }
+        d->seen = s->frame;
+        drawn_sync(s, d, v);
+    }
+
+    // Despawned since the last frame
+    for (int i = 0; i < s->drawn_capacity; ++i)
+    {
+        if (s->drawn[i].generation && s->drawn[i].seen != s->frame)
+            drawn_erase(s, &s->drawn[i]);
+    }
+
+    compose(s, snap);
+    view_follow(s);
+}
+
+// Red indicator: the spot is occupied AND the occupant is actually parked
+static bool spot_taken(const SimSnapshot *snap, const Map *map, const ParkingSpot *spot)
+{
+    int i = (int)(spot - map->parkings);
+    return (snap->spot_taken[i / 64] >> (i % 64)) & 1;
+}
+
+// Set one overlay tile, queueing it for presenting if it changed
+static void overlay_set(Screen *s, int x, int y, uint16_t cell)
+{
+    uint16_t *o = &s->overlay[y * s->width + x];
+    if (*o == cell)
+        return;
+    *o = cell;
+    mark_dirty(s, x, y, x + 1, y + 1);
+}
+
+// Bring the overlay up to date if a gate moved or an indicator turned
+// since it was last updated; the tiles that change are marked dirty.
+// Only the map's static layout is read; gate and spot state come from
+// the snapshot.
+static void overlay_update(Screen *s, const Map *map, const SimSnapshot *snap)
+{
+    if (s->overlay_valid && s->overlay_entry_open == snap->entry_open &&
+        s->overlay_exit_open == snap->exit_open &&
+        memcmp(snap->spot_taken, s->overlay_taken, sizeof(s->overlay_taken)) == 0)
+        return;
+
+    for (int i = 0; i < s->indicator_count; ++i)
+    {
+        int x = s->indicators[i] % s->width;
+        int y = s->indicators[i] / s->width;
+        const Tile *t = &map->tiles[y][x];
+        overlay_set(s, x, y, t->spot && spot_taken(snap, map, t->spot) ? CELL_SPOT_TAKEN : CELL_SPOT_FREE);
+    }
+    // Gate tiles take precedence over the map buffer
+    const Gate *gates[2] = {&map->gate_entry, &map->gate_exit};
+    const bool open[2] = {snap->entry_open, snap->exit_open};
+    for (int g = 1; g >= 0; --g) // entry wins where both claim a tile
+    {
+        for (int ti = 0; ti < gates[g]->tile_count; ++ti)
+        {
+            int x = gates[g]->xs[ti];
+            int y = gates[g]->ys[ti];
+            if (x < 0 || x >= s->width || y < 0 || y >= s->height ||
+                map->tiles[y][x].type == TILE_PARKING_INDICATOR)
                 continue;
-            }
+            overlay_set(s, x, y, open[g] ? CELL_GATE_OPEN : CELL_GATE_CLOSED);
+        }
+    }
 
-            char c = s->buffer[y][x];
+    memcpy(s->overlay_taken, snap->spot_taken, sizeof(s->overlay_taken));
+    s->overlay_entry_open = snap->entry_open;
+    s->overlay_exit_open = snap->exit_open;
+    s->overlay_valid = true;
+}
 
-            switch (c)
-            {
-            case '_':
-                printf("─");
-                break;
-            case '|':
-                printf("│");
-                break;
-            case 'R':
-                printf("┌");
-                break;
-            case 'T':
-                printf("┐");
-                break;
-            case 'L':
-                printf("└");
-                break;
-            case 'J':
-                printf("┘");
-                break;
-            case '+':
-                printf("┼");
-                break;
-            case '*':
-                printf("\033[90m*\033[0m");
-                break;
-            default:
-                putchar(c);
-                break;
-            }
+static char *put_str(char *p, const char *str)
+{
+    size_t len = strlen(str);
+    memcpy(p, str, len);
+    return p + len;
+}
+
+// "\033[<y>;<x>H" for the 0-based tile (x,y)
+static char *put_move(char *p, int x, int y)
+{
+    return p + sprintf(p, "\033[%d;%dH", y + 1, x + 1);
+}
+
+static char *put_color(char *p, uint8_t color)
+{
+    return color == COLOR_DEFAULT ? put_str(p, "\033[0m") : p + sprintf(p, "\033[%dm", color);
+}
+
+// Hand n bytes to the terminal, retrying short writes
+static void write_all(const char *buf, size_t n)
+{
+    while (n > 0)
+    {
+        ssize_t w = write(STDOUT_FILENO, buf, n);
+        if (w < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            debug_log("[render] write failed, dropping %zu bytes of the frame\n", n);
+            return;
         }
-        putchar('\n');
+        buf += w;
+        n -= (size_t)w;
     }
 }
 
-void screen_draw_paths(Screen *s, const VehicleList *vehicles)
+// Emit the changed cells of map row y in [x0,x1), all within the view.
+// *color is the terminal's current colour, carried across calls.
+static char *present_span(Screen *s, char *p, int y, int x0, int x1, uint8_t *color)
 {
-    for (VehicleNode *node = vehicles->head; node != NULL; node = node->next)
+    const char *row = &s->buffer[y * s->width];
+    const uint16_t *overlay = &s->overlay[y * s->width];
+    // Terminal cells of this row, shifted so the map x indexes them
+    uint16_t *front = &s->front[(y - s->view_y) * s->width - s->view_x];
+    bool in_run = false; // cursor sits right after the last emitted cell
+    for (int x = x0; x < x1; ++x)
     {
-        const Vehicle *v = &node->vehicle;
-        if (v->path.length <= 0)
+        uint16_t cell = overlay[x] ? overlay[x] : (unsigned char)row[x];
+        if (cell == front[x])
+        {
+            in_run = false;
             continue;
-
-        for (int i = v->path_index; i < v->path.length; ++i)
+        }
+        if (!in_run)
         {
-            int px = v->path.steps[i].x;
-            int py = v->path.steps[i].y;
+            p = put_move(p, x - s->view_x, y - s->view_y);
+            in_run = true;
+        }
+        const CellStyle *st = &g_styles[cell];
+        if (st->color != *color)
+        {
+            p = put_color(p, st->color);
+            *color = st->color;
+        }
+        memcpy(p, st->glyph, st->len);
+        p += st->len;
+        front[x] = cell;
+    }
+    return p;
+}
+
+void screen_present(Screen *s, const Map *map, const SimSnapshot *snap)
+{
+    debug_log("Step: %d\n", snap->step);
+    overlay_update(s, map, snap);
 
-            if (px >= 0 && px < s->width && py >= 0 && py < s->height)
+    char *p = s->out;
+    int vx0 = s->view_x, vx1 = s->view_x + s->view_w;
+    int vy0 = s->view_y, vy1 = s->view_y + s->view_h;
+    bool full = !s->front_valid || s->view_moved || s->all_dirty;
+    if (!s->front_valid)
+    {
+        p = put_str(p, "\033[0m\033[2J");
+        s->front_valid = true;
+    }
+
+    uint8_t color = COLOR_DEFAULT;
+    if (full)
+    {
+        for (int y = vy0; y < vy1; ++y)
+            p = present_span(s, p, y, vx0, vx1, &color);
+    }
+    else
+    {
+        // One span per row covering its dirty rects, in row order, so runs
+        // and colours carry across rects like in a full scan. Rects are
+        // clipped to the view.
+        for (int y = vy0; y < vy1; ++y)
+        {
+            s->span_x0[y] = vx1;
+            s->span_x1[y] = vx0;
+        }
+        for (int r = 0; r < s->dirty_count; ++r)
+        {
+            const ScreenRect *rc = &s->dirty[r];
+            int x0 = rc->x0 > vx0 ? rc->x0 : vx0;
+            int x1 = rc->x1 < vx1 ? rc->x1 : vx1;
+            int y0 = rc->y0 > vy0 ? rc->y0 : vy0;
+            int y1 = rc->y1 < vy1 ? rc->y1 : vy1;
+            for (int y = y0; y < y1 && x0 < x1; ++y)
             {
-                if (s->buffer[py][px] == ' ')
-                    s->buffer[py][px] = '*';
+                if (x0 < s->span_x0[y])
+                    s->span_x0[y] = x0;
+                if (x1 > s->span_x1[y])
+                    s->span_x1[y] = x1;
             }
         }
+        for (int y = vy0; y < vy1; ++y)
+        {
+            if (s->span_x0[y] < s->span_x1[y])
+                p = present_span(s, p, y, s->span_x0[y], s->span_x1[y], &color);
+        }
     }
+    s->dirty_count = 0;
+    s->all_dirty = false;
+    s->view_moved = false;
+
+    // Below the map for whatever is printed next; drop the old text there
+    if (color != COLOR_DEFAULT)
+        p = put_color(p, COLOR_DEFAULT);
+    p = put_move(p, 0, s->view_h);
+    p = put_str(p, "\033[J");
+
+    s->frame_bytes = (size_t)(p - s->out);
+    fflush(stdout); // keep the order with text printed through stdio
+    write_all(s->out, s->frame_bytes);
 }
@@ -3,13 +3,85 @@
 
 #include "../map/map.h"
 #include "../vehicle/vehicle.h"
-#include "../vehicle/vehicle_list.h"
+#include "../vehicle/vehicle_pool.h"
+#include "snapshot.h"
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Last drawn state of one vehicle slot (see screen_update)
+typedef struct
+{
+    uint32_t generation; // of the pool slot when drawn, 0 = nothing drawn
+    unsigned int seen;   // frame it was last found live
+    const Sprite *spr;
+    int x;
+    int y;
+    PathIter path_it; // remaining steps marked in path_marks (holds a path reference)
+} ScreenVehicle;
+
+// Terminal lines kept free below the view for the caller's text
+#define SCREEN_TEXT_ROWS 12
+
+// Rectangle of tiles to recomposite and present, [x0,x1) x [y0,y1)
+typedef struct
+{
+    int x0, y0, x1, y1;
+} ScreenRect;
+
+// The map view is composited from layers: the static background (map
+// symbols, built once), the remaining path steps of every vehicle and
+// the vehicles on top. Only the rectangles around what changed are
+// recomposited and presented. All grids are row-major, index
+// y * width + x. Only the view, the part of the map that fits the
+// terminal, is presented.
 typedef struct
 {
     int width;
     int height;
-    char **buffer; // buffer[height][width]
+    char *background;      // map symbols
+    unsigned int *path_marks; // remaining path steps of all vehicles per tile
+    char *buffer;          // composite of the layers
+    ScreenVehicle *drawn;  // indexed by pool slot
+    int drawn_capacity;
+    unsigned int frame;
+    unsigned int *dirty_stamp; // tile is in a dirty rect when == frame
+    ScreenRect *dirty;
+    int dirty_count;
+    int dirty_capacity;
+    bool all_dirty;
+    int *span_x0; // per row, scratch for screen_present
+    int *span_x1;
+    // Visible tiles [view_x, view_x + view_w) x [view_y, view_y + view_h)
+    int view_x;
+    int view_y;
+    int view_w;
+    int view_h;
+    bool view_moved;   // scrolled since the last screen_present
+    int term_rows;     // 0 = unknown (not a terminal)
+    int resize_seen;   // SIGWINCH count the view was fitted for
+    int follow_slot;   // vehicle the view keeps in sight, -1 = none
+    uint32_t follow_generation;
+    // What the terminal shows, one resolved cell per terminal cell of the
+    // view, index (y - view_y) * width + (x - view_x) (see render.c);
+    // screen_present only re-emits cells whose entry changed, so a
+    // scroll only rewrites what actually looks different
+    uint16_t *front;
+    bool front_valid; // false = terminal content unknown, redraw all
+    // Tiles the map draws over the buffer (spot indicators, gates), 0 =
+    // show the buffer. Updated when a gate or an indicator changes.
+    uint16_t *overlay;
+    int *indicators; // tile index of every spot indicator
+    int indicator_count;
+    bool overlay_valid;
+    bool overlay_entry_open;                   // gate state it shows
+    bool overlay_exit_open;
+    uint64_t overlay_taken[SPOT_MASK_WORDS];   // spots it shows as taken
+    // Frame assembled here and handed to the terminal in one write()
+    char *out;
+    size_t out_capacity;
+    size_t frame_bytes; // bytes written by the last screen_present
 } Screen;
 
 // Allocate screen buffer based on map size
@@ -18,15 +90,43 @@ int screen_init(Screen *s, const Map *map);
 // Free buffer
 void screen_free(Screen *s);
 
-// Fill buffer with static map glyphs
-void screen_from_map(Screen *s, const Map *map);
+// (Re)build the static background from the map's symbols. Call once
+// after screen_init and whenever the map's layout changes. Returns 0 on
+// OOM.
+int screen_from_map(Screen *s, const Map *map);
+
+// Bring the path and vehicle layers up to date with a snapshot: vehicles
+// that moved, turned, spawned or despawned mark their old and new
+// footprint dirty, path steps are marked when a path is set and unmarked
+// as the vehicle passes them. Then the dirty rectangles are recomposited.
+// Paths the screen still marks stay referenced until screen_free. The
+// view is refitted if the terminal was resized and scrolled to keep the
+// followed vehicle in sight.
+void screen_update(Screen *s, const SimSnapshot *snap);
+
+// Present the view to the terminal: only cells that changed since the
+// last call are written, in runs behind a cursor-positioning escape,
+// colour codes only where the colour changes. Only the dirty rectangles
+// within the view are compared unless the view moved. Only the static
+// layout of the map is read; gates and spots come from snap. The frame
+// goes out in a single write(); stdout is flushed first. The cursor is
+// left on the line below the view, with the rest of the terminal cleared.
+void screen_present(Screen *s, const Map *map, const SimSnapshot *snap);
+
+// Terminal lines below the view (INT_MAX if the height is unknown). Text
+// printed after screen_present must stay within them: scrolling would
+// move the map out from under the cells screen_present remembers.
+int screen_lines_below(const Screen *s);
 
-// Overlay one vehicle (multi-tile sprite)
-void screen_draw_vehicle(Screen *s, const Vehicle *v, const Map *map);
+// Forget what the terminal shows (something else drew over it): the next
+// screen_present clears it and redraws every cell
+void screen_invalidate(Screen *s);
 
-// Present buffer to terminal
-void screen_present(const Screen *s, const Map *map, int step);
+// Scroll the view by (dx, dy) tiles, within the map. Stops following.
+void screen_pan(Screen *s, int dx, int dy);
 
-void screen_draw_paths(Screen *s, const VehicleList *vehicles);
+// Keep the vehicle in pool slot `slot` of that generation in sight while
+// it is live (slot -1 = stop following)
+void screen_follow(Screen *s, int slot, uint32_t generation);
 
 #endif
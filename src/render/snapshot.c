@@ -0,0 +1,106 @@
+#include "snapshot.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SNAPSHOT_FRESH 4 // on middle: published, not yet picked up
+
+void snapshot_exchange_init(SnapshotExchange *x)
+{
+    memset(x, 0, sizeof(*x));
+    x->back = 0;
+    x->middle = 1;
+    x->front = 2;
+}
+
+// Drop the path references held by s
+static void snapshot_release(SimSnapshot *s)
+{
+    for (int i = 0; i < s->vehicle_count; ++i)
+        path_release(s->vehicles[i].path_it.path);
+    s->vehicle_count = 0;
+}
+
+void snapshot_exchange_free(SnapshotExchange *x)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        snapshot_release(&x->slots[i]);
+        free(x->slots[i].vehicles);
+    }
+    memset(x, 0, sizeof(*x));
+}
+
+SimSnapshot *snapshot_back(SnapshotExchange *x)
+{
+    return &x->slots[x->back];
+}
+
+bool snapshot_capture(SimSnapshot *s, const Map *map, VehiclePool *pool, uint64_t now_ms)
+{
+    snapshot_release(s);
+
+    int count;
+    Vehicle *const *live = vehicle_pool_live(pool, &count);
+    if (count > s->vehicle_capacity)
+    {
+        SnapVehicle *grown = realloc(s->vehicles, count * sizeof(SnapVehicle));
+        if (!grown)
+            return false;
+        s->vehicles = grown;
+        s->vehicle_capacity = count;
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        const Vehicle *v = live[i];
+        VehicleHandle h = vehicle_pool_handle(pool, v);
+        SnapVehicle *sv = &s->vehicles[i];
+        sv->slot = h.slot;
+        sv->generation = h.generation;
+        sv->x = v->x;
+        sv->y = v->y;
+        sv->spr = vehicle_get_sprite(v);
+        sv->path_it = v->path_it;
+        path_retain(sv->path_it.path);
+        sv->state = v->state;
+        sv->parking_time_sec = v->cold->parking_time_sec;
+        sv->remaining_sec = 0;
+        if (v->state == VEH_PARKED)
+        {
+            int64_t remaining_ms = (int64_t)(v->cold->parking_start_time_ms +
+                                             (uint64_t)v->cold->parking_time_sec * 1000 - now_ms);
+            sv->remaining_sec = remaining_ms > 0 ? (int)((remaining_ms + 999) / 1000) : 0;
+        }
+    }
+    s->vehicle_count = count;
+
+    s->entry_open = map->gate_entry.open;
+    s->exit_open = map->gate_exit.open;
+    memset(s->spot_taken, 0, sizeof(s->spot_taken));
+    for (int i = 0; i < map->parking_count; ++i)
+    {
+        const ParkingSpot *spot = &map->parkings[i];
+        if (spot->occupied && spot->occupant && spot->occupant->state == VEH_PARKED)
+            s->spot_taken[i / 64] |= 1ULL << (i % 64);
+    }
+    return true;
+}
+
+void snapshot_publish(SnapshotExchange *x)
+{
+    x->slots[x->back].seq = ++x->next_seq;
+    // Release: the consumer sees the slot's content once it sees the index
+    int old = __atomic_exchange_n(&x->middle, x->back | SNAPSHOT_FRESH, __ATOMIC_ACQ_REL);
+    x->back = old & ~SNAPSHOT_FRESH;
+}
+
+const SimSnapshot *snapshot_latest(SnapshotExchange *x)
+{
+    if (__atomic_load_n(&x->middle, __ATOMIC_ACQUIRE) & SNAPSHOT_FRESH)
+    {
+        int old = __atomic_exchange_n(&x->middle, x->front, __ATOMIC_ACQ_REL);
+        x->front = old & ~SNAPSHOT_FRESH;
+    }
+    const SimSnapshot *s = &x->slots[x->front];
+    return s->seq ? s : NULL;
+}
@@ -0,0 +1,76 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../map/map.h"
+#include "../path/path.h"
+#include "../traffic/traffic.h"
+#include "../vehicle/vehicle.h"
+#include "../vehicle/vehicle_pool.h"
+
+// What the renderer needs of one vehicle
+typedef struct
+{
+    // Pool slot and its generation: the same vehicle across snapshots
+    int slot;
+    uint32_t generation;
+    int x;
+    int y;
+    const Sprite *spr;
+    PathIter path_it; // holds a path reference while in the snapshot
+    VehicleState state;
+    int parking_time_sec;
+    int remaining_sec; // of parking, 0 unless parked
+} SnapVehicle;
+
+// Frame state captured by the simulation. Once published it is not
+// changed until the renderer has moved on to a newer one.
+typedef struct
+{
+    unsigned long seq; // publish count, 0 = never published
+    SnapVehicle *vehicles; // spawn order
+    int vehicle_count;
+    int vehicle_capacity;
+    bool entry_open;
+    bool exit_open;
+    uint64_t spot_taken[SPOT_MASK_WORDS]; // occupied by a parked vehicle
+    // Stat board
+    int step;
+    int account_balance;
+    unsigned long cache_hits;
+    unsigned long cache_misses;
+    TrafficStats traffic;
+} SimSnapshot;
+
+// Lock-free single-producer/single-consumer handoff (triple buffer): the
+// simulation fills the back slot and publishes it as the middle one, the
+// renderer swaps the middle slot in when it is newer than its front
+// slot. Snapshots the renderer had no time for are overwritten.
+typedef struct
+{
+    SimSnapshot slots[3];
+    int back;   // producer's slot
+    int front;  // consumer's slot
+    int middle; // slot index | SNAPSHOT_FRESH until picked up (atomic)
+    unsigned long next_seq;
+} SnapshotExchange;
+
+void snapshot_exchange_init(SnapshotExchange *x);
+// Release every slot (no thread may be using the exchange any more)
+void snapshot_exchange_free(SnapshotExchange *x);
+
+// Producer: the slot to fill next. Its old content is released by
+// snapshot_capture.
+SimSnapshot *snapshot_back(SnapshotExchange *x);
+// Fill s with the live vehicles, gate and spot state (stat board fields
+// are left to the caller). Returns false on OOM, with no vehicles in s.
+bool snapshot_capture(SimSnapshot *s, const Map *map, VehiclePool *pool, uint64_t now_ms);
+// Hand the back slot to the consumer
+void snapshot_publish(SnapshotExchange *x);
+
+// Consumer: newest published snapshot, NULL if none yet. Stays valid and
+// unchanged until the next call.
+const SimSnapshot *snapshot_latest(SnapshotExchange *x);
+
+#endif
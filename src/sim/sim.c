@@ -0,0 +1,355 @@
+#include "sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../common/debug.h"
+#include "../common/direction.h"
+#include "../path/flow_field.h"
+#include "../path/path_batch.h"
+#include "../path/path_cache.h"
+#include "../traffic/cooperative.h"
+#include "../traffic/scheduler.h"
+#include "../traffic/traffic.h"
+#include "../vehicle/vehicle.h"
+
+// Map, sprites and the routing tables built from them
+static bool assets_init(Map *map)
+{
+    if (!map_load(map, "assets/map.txt"))
+    {
+        debug_log("Failed to load map\n");
+        return false;
+    }
+
+    if (!vehicle_sprites_init("assets/carSmall"))
+    {
+        debug_log("Failed to init vehicle sprites\n");
+        map_free(map);
+        return false;
+    }
+
+    // Clearance layers for every car orientation (used by pathfinding),
+    // plus 1x1 for the waypoint legs that only check the anchor tile
+    const VehicleSprites *sprites = vehicle_sprites_get_default();
+    map_add_footprint(map, 1, 1);
+    map_add_footprint(map, sprites->east.width, sprites->east.height);
+    map_add_footprint(map, sprites->north.width, sprites->north.height);
+
+    // Distance fields towards every fixed goal, so routing needs no search
+    flow_fields_precompute(map, 1, 1);
+    flow_fields_precompute(map, sprites->east.width, sprites->east.height);
+    flow_fields_precompute(map, sprites->north.width, sprites->north.height);
+    return true;
+}
+
+// True if a vehicle other than `except` stands on an exit gate tile
+// (closing the gate would trap it there). Only awake vehicles are checked:
+// sleepers are either parked or new arrivals waiting at the spawn point
+// for the entry gate, and neither stands on the exit gate.
+static bool exit_gate_in_use(const Map *map, VehiclePool *vehicles, const Vehicle *except)
+{
+    int count;
+    Vehicle *const *active = vehicle_pool_active(vehicles, &count);
+    for (int i = 0; i < count; ++i) {
+        const Vehicle *v = active[i];
+        if (v == except)
+            continue;
+        const Sprite *spr = vehicle_get_sprite(v);
+        for (int ti = 0; ti < map->gate_exit.tile_count; ++ti) {
+            if (sprite_covers(spr, map->gate_exit.xs[ti] - v->x, map->gate_exit.ys[ti] - v->y))
+                return true;
+        }
+    }
+    return false;
+}
+
+// Batched exit path result: drive it, or retry on a later frame
+static void apply_exit_path(void *user, const Path *p)
+{
+    Vehicle *v = user;
+    debug_log("[DEBUG] Exit path for vehicle at (%d,%d): found %d, length %d\n", v->x, v->y, p != NULL, p ? p->length : 0);
+    if (p) {
+        vehicle_set_path(v, p);
+        v->state = VEH_DRIVING;
+    }
+}
+
+bool sim_init(Sim *sim, const Config *config, bool sounds)
+{
+    memset(sim, 0, sizeof(*sim));
+    sim->config = *config;
+    sim->sounds = sounds;
+    sim->tick_ms = config->frame_dt_ms / 2; // the game runs at double speed
+    if (sim->tick_ms < 1)
+        sim->tick_ms = 1;
+    sim->newest = (VehicleHandle){-1, 0};
+    sim->phase = PHASE_SPAWN;
+    sim->last_vehicle_x = -1;
+    sim->last_vehicle_y = -1;
+
+    path_set_planner(config->planner ? PATH_PLANNER_JPS : PATH_PLANNER_ASTAR);
+    traffic_set_cooperative(config->cooperative ? config->coop_window : 0);
+    traffic_set_parking_time(config->min_parking_time_sec, config->max_parking_time_sec);
+    path_batch_start(config->plan_threads);
+    if (!assets_init(&sim->map))
+    {
+        path_batch_stop();
+        return false;
+    }
+    vehicle_pool_init(&sim->vehicles);
+
+    // Ensure gate is closed at start
+    map_set_gate_open(&sim->map, 0);
+    return true;
+}
+
+int sim_parked_count(const Sim *sim)
+{
+    int parked = 0;
+    for (int i = 0; i < sim->map.parking_count; ++i)
+    {
+        const ParkingSpot *spot = &sim->map.parkings[i];
+        if (spot->occupied && spot->occupant && spot->occupant->state == VEH_PARKED)
+            parked++;
+    }
+    return parked;
+}
+
+void sim_tick(Sim *sim)
+{
+    sim->step++;
+    // State machine for gate/vehicle logic
+    switch (sim->phase) {
+        case PHASE_SPAWN: {
+            // Spawn a new vehicle at start
+            Vehicle v;
+            int vx = 133, vy = 27;
+            if (sim->map.has_start) {
+                vx = sim->map.start_x;
+                vy = sim->map.start_y;
+            }
+            vehicle_init(&v, vx, vy, DIR_WEST);
+            Vehicle *nv = vehicle_pool_spawn(&sim->vehicles, &v);
+            if (nv) {
+                sim->stats.spawned++;
+                sim->newest = vehicle_pool_handle(&sim->vehicles, nv);
+                traffic_init_vehicle_route(nv, &sim->map);
+                // No way past the closed gate: sleep until it opens, so
+                // the lot can be idle while the car waits (sim_skip_idle)
+                if (!nv->has_path)
+                    vehicle_pool_sleep(&sim->vehicles, nv);
+            }
+            sim->vehicle_steps = 0;
+            sim->last_vehicle_x = vx;
+            sim->last_vehicle_y = vy;
+            // Use mode-specific spawn rate. It has always counted frame time,
+            // frame_dt_ms per step or twice the clock.
+            sim->phase_until_ms = sim->now_ms + sim->config.spawn_rate_ms / 2;
+            sim->phase = PHASE_WAIT_OPEN;
+            break;
+        }
+        case PHASE_WAIT_OPEN:
+            if (sim->now_ms >= sim->phase_until_ms) {
+                map_set_gate_open(&sim->map, 1); // open gate
+                // Replan path for the most recent vehicle if not parking and has no path
+                Vehicle *last = vehicle_pool_get(&sim->vehicles, sim->newest);
+                if (last)
+                    vehicle_pool_wake(&sim->vehicles, last);
+                if (last && !last->going_to_parking && !last->has_path) {
+                    traffic_init_vehicle_route(last, &sim->map);
+                }
+                sim->phase = PHASE_OPEN;
+            }
+            break;
+        case PHASE_OPEN: {
+            // Count steps for the most recent vehicle
+            Vehicle *last = vehicle_pool_get(&sim->vehicles, sim->newest);
+            if (last) {
+                // Only count steps if vehicle actually moves
+                if (last->x != sim->last_vehicle_x || last->y != sim->last_vehicle_y) {
+                    sim->vehicle_steps++;
+                    sim->last_vehicle_x = last->x;
+                    sim->last_vehicle_y = last->y;
+                }
+                int steps_needed = last->sprites->east.width + 2;
+                if (sim->vehicle_steps >= steps_needed) {
+                    map_set_gate_open(&sim->map, 0); // close gate
+                    sim->phase_until_ms = sim->now_ms + 1000; // 1 second
+                    sim->phase = PHASE_WAIT_CLOSE;
+                }
+            }
+            break;
+        }
+        case PHASE_WAIT_CLOSE:
+            if (sim->now_ms >= sim->phase_until_ms) {
+                sim->phase = PHASE_WAIT_SPAWN;
+                sim->phase_until_ms = sim->now_ms + 1000; // 1 second wait before next spawn
+            }
+            break;
+        case PHASE_WAIT_SPAWN:
+            if (sim->now_ms >= sim->phase_until_ms) {
+                sim->phase = PHASE_SPAWN;
+            }
+            break;
+    }
+
+    // Parked vehicles whose time is up start backing out
+    Vehicle *due;
+    while ((due = scheduler_pop_due(sim->now_ms)) != NULL) {
+        debug_log("[DEBUG] Vehicle at (%d,%d): Parking time elapsed, switching to LEAVING.\n", due->x, due->y);
+        due->state = VEH_LEAVING;
+        const Sprite *spr = vehicle_get_sprite(due);
+        due->cold->reverse_steps_remaining = spr->width + 2; // Back out 2 extra tiles for testing
+        debug_log("[DEBUG] Vehicle: Starting to reverse out (%d steps)\n", due->cold->reverse_steps_remaining);
+        vehicle_pool_wake(&sim->vehicles, due);
+    }
+
+    // --- Back out logic for VEH_LEAVING ---
+    int active_count;
+    Vehicle *const *active = vehicle_pool_active(&sim->vehicles, &active_count);
+    for (int i = 0; i < active_count; ++i) {
+        Vehicle *v = active[i];
+        // When vehicle reaches (0,1), close the gate again
+        if (v->state == VEH_DRIVING && v->x == MAP_EXIT_X && v->y == MAP_EXIT_Y) {
+            if (sim->map.gate_exit.open && !exit_gate_in_use(&sim->map, &sim->vehicles, v)) {
+                path_batch_flush(&sim->map); // plan queued requests on the map they were made for
+                map_set_exit_gate_open(&sim->map, 0);
+                debug_log("[DEBUG] Exit gate closed after vehicle reached (0,1).\n");
+            }
+            // Add money to account based on parking_time_sec and mark for deletion
+            int payout = v->cold->parking_time_sec * 10;
+            sim->game.account_balance += payout;
+            if (sim->sounds)
+                system("play assets/sounds/money_count.mp3 > /dev/null 2>&1 &");
+            debug_log("[DEBUG] Vehicle at (0,1) exited. +%d to account for %d seconds parked. Marking for removal.\n", payout, v->cold->parking_time_sec);
+            v->state = VEH_REMOVED;
+            traffic_note_exit();
+        }
+        // Handle exit gate opening for single vehicle
+        // Transition to exit queue and immediately assign path if vehicle reaches 'E' tile (exit entry spot)
+        if ((v->state == VEH_DRIVING || v->state == VEH_EXIT_QUEUE) && sim->map.has_end && v->x == sim->map.end_x && v->y == sim->map.end_y) {
+            if (!sim->map.gate_exit.open) {
+                path_batch_flush(&sim->map);
+                map_set_exit_gate_open(&sim->map, 1);
+                debug_log("[DEBUG] Exit gate opened for vehicle at (%d,%d).\n", v->x, v->y);
+            }
+            v->state = VEH_EXIT_QUEUE;
+            v->has_path = 0;
+            debug_log("[DEBUG] Vehicle at (%d,%d): Reached exit entry spot ('E'), now in exit queue.\n", v->x, v->y);
+            // Set path goal to the exit tile (0,1)
+            int target_x = MAP_EXIT_X, target_y = MAP_EXIT_Y;
+            const Sprite *spr = vehicle_get_sprite(v);
+            debug_log("[DEBUG] Car sprite width: %d, height: %d\n", spr ? spr->width : -1, spr ? spr->height : -1);
+            path_batch_add(&sim->map, v->x, v->y, target_x, target_y, 1, 1, apply_exit_path, v);
+        }
+        // When vehicle reaches (0,1), close the gate again
+        if (v->state == VEH_DRIVING && v->x == MAP_EXIT_X && v->y == MAP_EXIT_Y) {
+            if (sim->map.gate_exit.open && !exit_gate_in_use(&sim->map, &sim->vehicles, v)) {
+                path_batch_flush(&sim->map); // plan queued requests on the map they were made for
+                map_set_exit_gate_open(&sim->map, 0);
+                debug_log("[DEBUG] Exit gate closed after vehicle reached (0,1).\n");
+            }
+        }
+        if (v->state == VEH_LEAVING && v->cold->reverse_steps_remaining > 0) {
+            debug_log("[DEBUG] Vehicle at (%d,%d) in LEAVING, reverse_steps_remaining=%d\n", v->x, v->y, v->cold->reverse_steps_remaining);
+            // Move in the opposite direction of v->dir
+            switch (v->dir) {
+                case DIR_EAST:  v->x -= 1; break;
+                case DIR_WEST:  v->x += 1; break;
+                case DIR_NORTH: v->y += 1; break;
+                case DIR_SOUTH: v->y -= 1; break;
+            }
+            v->cold->reverse_steps_remaining--;
+            debug_log("[DEBUG] Vehicle: Reversing, steps remaining: %d\n", v->cold->reverse_steps_remaining);
+            // Only clear parking assignment after reversing is done
+            if (v->cold->reverse_steps_remaining == 0) {
+                // Only clear parking assignment once
+                if (v->cold->assigned_spot) {
+                    debug_log("[DEBUG] Vehicle: Finished reversing, clearing parking spot and searching for exit tile...\n");
+                    map_release_spot(&sim->map, v->cold->assigned_spot);
+                    v->cold->assigned_spot = NULL;
+                    v->cold->parking_spot_id = -1;
+                }
+                // Always try to plan path to exit if not already driving
+                if (v->state == VEH_LEAVING) {
+                    if (sim->map.has_end) {
+                        int ex = sim->map.end_x;
+                        int ey = sim->map.end_y;
+                        const Sprite *spr = vehicle_get_sprite(v);
+                        int car_w = spr->width;
+                        int car_h = spr->height;
+                        debug_log("[DEBUG] Attempting to pathfind_with_size from (%d, %d) to exit (%d, %d) with car size %dx%d\n", v->x, v->y, ex, ey, car_w, car_h);
+                        if (!map_is_walkable(&sim->map, v->x, v->y)) {
+                            debug_log("[DEBUG] Vehicle at (%d,%d) is not on a walkable tile! Tile type: %d\n", v->x, v->y, sim->map.tiles[v->y][v->x].type);
+                        }
+                        if (!map_is_walkable(&sim->map, ex, ey)) {
+                            debug_log("[DEBUG] Exit tile at (%d,%d) is not walkable! Tile type: %d\n", ex, ey, sim->map.tiles[ey][ex].type);
+                        }
+                        path_batch_add(&sim->map, v->x, v->y, ex, ey, car_w, car_h, apply_exit_path, v);
+                    } else {
+                        debug_log("[DEBUG] No exit tile found: map.has_end is not set!\n");
+                    }
+                }
+            }
+        }
+    }
+    // Plan the exit paths requested above
+    path_batch_flush(&sim->map);
+
+    // One traffic simulation step (move + path replanning)
+    traffic_step(&sim->vehicles, &sim->map, sim->now_ms);
+    // Remove vehicles marked for deletion (only awake vehicles exit)
+    active = vehicle_pool_active(&sim->vehicles, &active_count);
+    for (int i = 0; i < active_count; ++i) {
+        if (active[i]->state == VEH_REMOVED)
+            vehicle_pool_despawn(&sim->vehicles, active[i]);
+    }
+
+    int parked = sim_parked_count(sim);
+    sim->stats.parked_spot_ticks += parked;
+    if (parked > sim->stats.peak_parked)
+        sim->stats.peak_parked = parked;
+    sim->stats.ticks++;
+    sim->now_ms += sim->tick_ms;
+}
+
+unsigned long sim_skip_idle(Sim *sim, uint64_t limit_ms)
+{
+    int active_count;
+    vehicle_pool_active(&sim->vehicles, &active_count);
+    if (active_count > 0 || sim->phase == PHASE_SPAWN)
+        return 0;
+
+    // With nobody awake, only the clock can change anything: a waiting
+    // phase ending or a parked vehicle waking up. PHASE_OPEN waits for
+    // the newest vehicle, which is parked, so only for the scheduler.
+    uint64_t next = scheduler_next_due();
+    if (sim->phase != PHASE_OPEN && sim->phase_until_ms < next)
+        next = sim->phase_until_ms;
+    if (next > limit_ms)
+        next = limit_ms;
+    if (next <= sim->now_ms)
+        return 0;
+
+    // Steps strictly before `next` would do nothing
+    unsigned long ticks = (next - sim->now_ms + sim->tick_ms - 1) / sim->tick_ms;
+    int parked = sim_parked_count(sim);
+    sim->now_ms += (uint64_t)ticks * sim->tick_ms;
+    sim->step += (int)ticks;
+    sim->stats.ticks += ticks;
+    sim->stats.parked_spot_ticks += (unsigned long long)parked * ticks;
+    traffic_note_idle_ticks(ticks);
+    return ticks;
+}
+
+void sim_free(Sim *sim)
+{
+    scheduler_free();
+    vehicle_pool_free(&sim->vehicles);
+    path_batch_stop();
+    path_cache_clear();
+    cooperative_free();
+    flow_fields_free();
+    map_free(&sim->map);
+}
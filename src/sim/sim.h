@@ -0,0 +1,75 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../common/game.h"
+#include "../map/map.h"
+#include "../vehicle/vehicle_pool.h"
+
+// Entry gate cycle: spawn, wait, open, let the car in, close, wait
+typedef enum
+{
+    PHASE_SPAWN,
+    PHASE_WAIT_OPEN,
+    PHASE_OPEN,
+    PHASE_WAIT_CLOSE,
+    PHASE_WAIT_SPAWN
+} SimPhase;
+
+// Run totals for the KPIs
+typedef struct
+{
+    unsigned long ticks;
+    unsigned long spawned;
+    unsigned long long parked_spot_ticks; // spots held by parked vehicles, summed over ticks
+    int peak_parked;
+} SimStats;
+
+// The simulation core shared by the interactive game and headless runs:
+// the lot, its vehicles and the entry gate cycle. It keeps its own clock,
+// so it runs paced to the wall clock or as fast as the CPU allows alike.
+typedef struct
+{
+    Config config; // with the mode selected (config_select_mode)
+    bool sounds;   // play sound effects
+    Map map;
+    VehiclePool vehicles;
+    Game game;
+    SimPhase phase;
+    uint64_t phase_until_ms; // end of a waiting phase
+    VehicleHandle newest; // most recently spawned vehicle
+    int vehicle_steps;    // it has taken through the entry gate
+    int last_vehicle_x;
+    int last_vehicle_y;
+    int step;
+    // Simulation clock: all simulated time (gate phases, parking) is read
+    // from here, never from the wall clock, so runs are reproducible. It
+    // advances by tick_ms per step, the pace the game has always had.
+    uint64_t now_ms;
+    int tick_ms;
+    SimStats stats;
+} Sim;
+
+// Load the assets and set up the traffic modules for config. Returns
+// false on failure, with nothing left to free.
+bool sim_init(Sim *sim, const Config *config, bool sounds);
+
+// One step at the current simulated time: gate cycle, parked vehicles
+// whose time is up, exits, then one traffic step. Advances the clock by
+// tick_ms.
+void sim_tick(Sim *sim);
+
+// If nothing can move (no awake vehicle, the gate cycle waiting), jump
+// the clock to the step of the next event: a phase ending or a parked
+// vehicle's time being up, but not past limit_ms. The skipped steps are
+// counted as if run, so results do not change. Returns their number.
+unsigned long sim_skip_idle(Sim *sim, uint64_t limit_ms);
+
+// Spots currently held by parked vehicles
+int sim_parked_count(const Sim *sim);
+
+// Free the lot, its vehicles and the traffic modules' state
+void sim_free(Sim *sim);
+
+#endif // SIM_H
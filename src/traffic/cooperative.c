@@ -0,0 +1,332 @@
+#include "cooperative.h"
+
+#include <stdlib.h>
+
+#include "../common/debug.h"
+#include "../path/path_heap.h"
+#include "reservation.h"
+
+// Search state = (x, y) relative to the vehicle, tick t and facing.
+// With unit moves the vehicle stays within `window` tiles of its start.
+static ReservationTable g_table;
+static PathHeap g_heap;
+static int *g_came_from = NULL;
+static unsigned int *g_seen = NULL; // state seen where g_seen[i] == g_generation
+static unsigned int g_generation = 0;
+static int g_window = 0;
+static int g_side = 0; // 2 * window + 1
+static int g_states = 0;
+static PathBuilder g_builder; // detours are spliced here
+
+// Step per Direction (NORTH, SOUTH, WEST, EAST)
+static const int step_dx[4] = {0, 0, -1, 1};
+static const int step_dy[4] = {-1, 1, 0, 0};
+
+static bool coop_prepare(const Map *map, int window)
+{
+    if (g_seen && g_table.width == map->width && g_table.height == map->height && g_window == window)
+        return true;
+
+    cooperative_free();
+    int side = 2 * window + 1;
+    int states = (window + 1) * side * side * 4;
+    g_came_from = malloc(states * sizeof(int));
+    g_seen = calloc(states, sizeof(unsigned int));
+    if (!g_came_from || !g_seen ||
+        !reservation_init(&g_table, map->width, map->height, window) ||
+        !path_heap_init(&g_heap, states))
+    {
+        cooperative_free();
+        return false;
+    }
+    g_window = window;
+    g_side = side;
+    g_states = states;
+    g_generation = 0;
+    return true;
+}
+
+void cooperative_free(void)
+{
+    reservation_free(&g_table);
+    path_heap_free(&g_heap);
+    free(g_came_from);
+    free(g_seen);
+    g_came_from = NULL;
+    g_seen = NULL;
+    g_window = 0;
+    g_side = 0;
+    g_states = 0;
+    path_builder_free(&g_builder);
+}
+
+static int state_index(int lx, int ly, int t, int dir)
+{
+    return ((t * g_side + ly) * g_side + lx) * 4 + dir;
+}
+
+// (ox, oy) is where the vehicle stood when the search started
+static void state_decode(int ox, int oy, int idx, int *x, int *y, int *t, int *dir)
+{
+    *dir = idx % 4;
+    idx /= 4;
+    *x = ox + idx % g_side - g_window;
+    idx /= g_side;
+    *y = oy + idx % g_side - g_window;
+    *t = idx / g_side;
+}
+
+// True if v facing dir can stand at (x,y) at tick t: all tiles walkable,
+// no parked (sleeping) vehicle there, nobody standing there right now (for
+// the step about to be taken) and nothing reserved for t
+static bool can_occupy(const VehiclePool *pool, const Map *map, const Vehicle *v,
+                       Direction dir, int x, int y, int t)
+{
+    const Sprite *spr = vehicle_get_sprite_for_dir(v, dir);
+    for (int sy = 0; sy < spr->height; ++sy)
+    {
+        if (!map_row_mask_walkable(map, x, y + sy, spr->row_masks[sy]))
+            return false;
+    }
+    if (!vehicle_pool_sleepers_clear(pool, spr, x, y))
+        return false;
+    if (t == 1 && !reservation_sprite_free(&g_table, spr, x, y, 0, v))
+        return false;
+    return reservation_sprite_free(&g_table, spr, x, y, t, v);
+}
+
+// Space-time A* for v towards path tile (px[steps], py[steps]), where
+// px/py[t] is where the vehicle would be at tick t on its path. Waiting
+// costs a tick like a move; ties prefer staying on the path. The search
+// ends on the target or at the window horizon, whichever f ranks first;
+// if neither can be reached the deepest partial plan is used.
+// Fills chain[0..t_end] with states and returns t_end (0 = no plan).
+static int coop_plan(const VehiclePool *pool, const Map *map, const Vehicle *v,
+                     const int *px, const int *py, int steps, int *chain, bool *reached)
+{
+    int window = g_window;
+    int tx = px[steps];
+    int ty = py[steps];
+
+    if (++g_generation == 0)
+    {
+        for (int i = 0; i < g_states; ++i)
+            g_seen[i] = 0;
+        g_generation = 1;
+    }
+    path_heap_clear(&g_heap);
+
+    int start = state_index(window, window, 0, v->dir);
+    g_seen[start] = g_generation;
+    g_came_from[start] = -1;
+    int h0 = abs(tx - v->x) + abs(ty - v->y);
+    path_heap_push(&g_heap, start, h0, 2 * h0);
+
+    int goal = -1;
+    int best = start; // deepest state seen, in case every branch dead-ends
+    int best_t = 0;
+    while (!path_heap_empty(&g_heap))
+    {
+        PathHeapNode node = path_heap_pop(&g_heap);
+        int x, y, t, dir;
+        state_decode(v->x, v->y, node.idx, &x, &y, &t, &dir);
+        if ((x == tx && y == ty) || t == window)
+        {
+            goal = node.idx;
+            break;
+        }
+        if (t > best_t)
+        {
+            best = node.idx;
+            best_t = t;
+        }
+
+        // 0..3 = step towards that Direction, 4 = wait
+        for (int a = 0; a < 5; ++a)
+        {
+            int ndir = a < 4 ? a : dir;
+            int nx = x + (a < 4 ? step_dx[a] : 0);
+            int ny = y + (a < 4 ? step_dy[a] : 0);
+            int n_idx = state_index(nx - v->x + window, ny - v->y + window, t + 1, ndir);
+            if (g_seen[n_idx] == g_generation)
+                continue;
+            // Staying put for the coming tick is always possible
+            bool stay_now = (a == 4 && t == 0);
+            if (!stay_now && !can_occupy(pool, map, v, ndir, nx, ny, t + 1))
+                continue;
+            g_seen[n_idx] = g_generation;
+            g_came_from[n_idx] = node.idx;
+            int h = abs(tx - nx) + abs(ty - ny);
+            int off_path = !(nx == px[t + 1] && ny == py[t + 1]);
+            path_heap_push(&g_heap, n_idx, t + 1 + h, 2 * h + off_path);
+        }
+    }
+    if (goal < 0)
+        goal = best; // reservations close in before the horizon: go as far as possible
+
+    int x, y, t_end, dir;
+    state_decode(v->x, v->y, goal, &x, &y, &t_end, &dir);
+    *reached = (x == tx && y == ty);
+    for (int i = goal, t = t_end; i >= 0; i = g_came_from[i], --t)
+        chain[t] = i;
+    return t_end;
+}
+
+// New path: the planned detour chain[0..t_end] followed by the rest of
+// the old path from the target on. NULL on OOM.
+static const Path *coop_splice(const Vehicle *v, const int *chain, int t_end, PathIter rest)
+{
+    path_builder_start(&g_builder, v->x, v->y);
+    for (int t = 1; t <= t_end; ++t)
+    {
+        int x, y, st, dir;
+        state_decode(v->x, v->y, chain[t], &x, &y, &st, &dir);
+        if (x == g_builder.x && y == g_builder.y)
+            continue; // waiting
+        if (!path_builder_step(&g_builder, x, y))
+            return NULL;
+    }
+    while (path_iter_has_next(&rest))
+    {
+        int x, y;
+        path_iter_peek(&rest, &x, &y);
+        if (!path_builder_step(&g_builder, x, y))
+            return NULL;
+        path_iter_advance(&rest);
+    }
+    return path_builder_share(&g_builder);
+}
+
+int cooperative_update_all(VehiclePool *pool, Map *map, int window)
+{
+    if (window < COOP_MIN_WINDOW)
+        window = COOP_MIN_WINDOW;
+    if (window > COOP_MAX_WINDOW)
+        window = COOP_MAX_WINDOW;
+    if (!coop_prepare(map, window) || !vehicle_pool_sync_occupancy(pool, map))
+        return vehicles_update_all(pool, map);
+
+    // Awake vehicles hold their tiles now; those without a path hold them
+    // for the whole window. Parked ones block through the occupancy grid.
+    reservation_clear(&g_table);
+    int count;
+    Vehicle *const *active = vehicle_pool_active(pool, &count);
+    for (int i = 0; i < count; ++i)
+    {
+        Vehicle *v = active[i];
+        const Sprite *spr = vehicle_get_sprite(v);
+        int moving = v->has_path && path_iter_has_next(&v->path_it);
+        for (int t = 0; t <= (moving ? 0 : window); ++t)
+            reservation_reserve_sprite(&g_table, spr, v->x, v->y, t, v);
+    }
+
+    int blocked = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        Vehicle *v = active[i];
+        if (!v->has_path || !path_iter_has_next(&v->path_it))
+        {
+            v->has_path = 0;
+            continue;
+        }
+
+        // Where the path would put the vehicle at each tick of the window
+        int px[COOP_MAX_WINDOW + 1];
+        int py[COOP_MAX_WINDOW + 1];
+        PathIter ahead = v->path_it;
+        int steps = 0;
+        px[0] = v->x;
+        py[0] = v->y;
+        while (steps < window && path_iter_has_next(&ahead))
+        {
+            steps++;
+            path_iter_peek(&ahead, &px[steps], &py[steps]);
+            path_iter_advance(&ahead);
+        }
+        for (int t = steps + 1; t <= window; ++t)
+        {
+            px[t] = px[steps];
+            py[t] = py[steps];
+        }
+
+        int chain[COOP_MAX_WINDOW + 1];
+        bool reached = false;
+        int t_end = coop_plan(pool, map, v, px, py, steps, chain, &reached);
+
+        const Sprite *old_spr = vehicle_get_sprite(v);
+        int old_x = v->x;
+        int old_y = v->y;
+        int moved = 0;
+        if (t_end > 0)
+        {
+            int x, y, t, dir;
+            state_decode(old_x, old_y, chain[1], &x, &y, &t, &dir);
+            if (x == old_x && y == old_y)
+            {
+                // Waiting for a vehicle with higher priority
+            }
+            else if (x == px[1] && y == py[1])
+            {
+                moved = 1;
+            }
+            else if (reached)
+            {
+                const Path *p = coop_splice(v, chain, t_end, ahead);
+                if (p)
+                {
+                    debug_log("[coop] Vehicle at (%d,%d) detours, rejoining its path at (%d,%d)\n",
+                              old_x, old_y, px[steps], py[steps]);
+                    vehicle_set_path(v, p);
+                    moved = 1;
+                }
+                else
+                {
+                    t_end = 0;
+                }
+            }
+            else
+            {
+                t_end = 0; // a detour that does not rejoin the path: hold
+            }
+
+            if (moved)
+            {
+                v->dir = (Direction)dir;
+                v->x = x;
+                v->y = y;
+                path_iter_advance(&v->path_it);
+                if (!path_iter_has_next(&v->path_it))
+                    v->has_path = 0; // reached goal
+            }
+        }
+
+        // Publish the plan so the vehicles after this one avoid it
+        reservation_release_sprite(&g_table, old_spr, old_x, old_y, 0, v);
+        reservation_reserve_sprite(&g_table, vehicle_get_sprite(v), v->x, v->y, 0, v);
+        for (int t = 1; t <= window; ++t)
+        {
+            if (t <= t_end)
+            {
+                int x, y, st, dir;
+                state_decode(old_x, old_y, chain[t], &x, &y, &st, &dir);
+                reservation_reserve_sprite(&g_table, vehicle_get_sprite_for_dir(v, (Direction)dir),
+                                           x, y, t, v);
+            }
+            else if (t_end > 0)
+            {
+                int x, y, st, dir;
+                state_decode(old_x, old_y, chain[t_end], &x, &y, &st, &dir);
+                reservation_reserve_sprite(&g_table, vehicle_get_sprite_for_dir(v, (Direction)dir),
+                                           x, y, t, v);
+            }
+            else
+            {
+                reservation_reserve_sprite(&g_table, vehicle_get_sprite(v), v->x, v->y, t, v);
+            }
+        }
+
+        if (!moved)
+            blocked++;
+    }
+    return blocked;
+}
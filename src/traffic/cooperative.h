@@ -0,0 +1,23 @@
+#ifndef COOPERATIVE_H
+#define COOPERATIVE_H
+
+#include "../map/map.h"
+#include "../vehicle/vehicle_pool.h"
+
+#define COOP_MIN_WINDOW 2
+#define COOP_MAX_WINDOW 16
+
+// Windowed cooperative A* (WHCA*) mover, an alternative to
+// vehicles_update_all. Vehicles plan in list order: each one searches
+// space-time (x, y, tick) over the next `window` ticks, may wait or step
+// aside to let others pass, and reserves its footprint along the result
+// so later vehicles plan around it. The search aims for the tile `window`
+// steps ahead on the vehicle's path; a detour is spliced into the path.
+// Only the first step is executed, everyone replans on the next tick.
+// Returns the number of vehicles that had a path but did not move.
+int cooperative_update_all(VehiclePool *pool, Map *map, int window);
+
+// Release the reservation table and search buffers
+void cooperative_free(void);
+
+#endif // COOPERATIVE_H
@@ -0,0 +1,95 @@
+#include "reservation.h"
+
+#include <stdlib.h>
+
+static int slot(const ReservationTable *rt, int x, int y, int t)
+{
+    if (x < 0 || x >= rt->width || y < 0 || y >= rt->height || t < 0 || t > rt->window)
+        return -1;
+    return (t * rt->height + y) * rt->width + x;
+}
+
+bool reservation_init(ReservationTable *rt, int width, int height, int window)
+{
+    int slots = width * height * (window + 1);
+    rt->width = width;
+    rt->height = height;
+    rt->window = window;
+    rt->generation = 1;
+    rt->stamp = calloc(slots, sizeof(unsigned int));
+    rt->owner = malloc(slots * sizeof(const Vehicle *));
+    if (!rt->stamp || !rt->owner)
+    {
+        reservation_free(rt);
+        return false;
+    }
+    return true;
+}
+
+void reservation_free(ReservationTable *rt)
+{
+    free(rt->stamp);
+    free((void *)rt->owner);
+    rt->stamp = NULL;
+    rt->owner = NULL;
+    rt->width = 0;
+    rt->height = 0;
+    rt->window = 0;
+}
+
+void reservation_clear(ReservationTable *rt)
+{
+    rt->generation++;
+    if (rt->generation == 0)
+    {
+        // Wrapped around: old stamps could look current again
+        int slots = rt->width * rt->height * (rt->window + 1);
+        for (int i = 0; i < slots; ++i)
+            rt->stamp[i] = 0;
+        rt->generation = 1;
+    }
+}
+
+const Vehicle *reservation_owner(const ReservationTable *rt, int x, int y, int t)
+{
+    int i = slot(rt, x, y, t);
+    if (i < 0 || rt->stamp[i] != rt->generation)
+        return NULL;
+    return rt->owner[i];
+}
+
+void reservation_reserve_sprite(ReservationTable *rt, const Sprite *spr,
+                                int x, int y, int t, const Vehicle *owner)
+{
+    for (int c = 0; c < spr->cell_count; ++c)
+    {
+        int i = slot(rt, x + spr->cells[c].dx, y + spr->cells[c].dy, t);
+        if (i < 0)
+            continue;
+        rt->stamp[i] = rt->generation;
+        rt->owner[i] = owner;
+    }
+}
+
+void reservation_release_sprite(ReservationTable *rt, const Sprite *spr,
+                                int x, int y, int t, const Vehicle *owner)
+{
+    for (int c = 0; c < spr->cell_count; ++c)
+    {
+        int i = slot(rt, x + spr->cells[c].dx, y + spr->cells[c].dy, t);
+        if (i >= 0 && rt->stamp[i] == rt->generation && rt->owner[i] == owner)
+            rt->owner[i] = NULL;
+    }
+}
+
+bool reservation_sprite_free(const ReservationTable *rt, const Sprite *spr,
+                             int x, int y, int t, const Vehicle *self)
+{
+    for (int c = 0; c < spr->cell_count; ++c)
+    {
+        const Vehicle *holder = reservation_owner(rt, x + spr->cells[c].dx, y + spr->cells[c].dy, t);
+        if (holder && holder != self)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef RESERVATION_H
+#define RESERVATION_H
+
+#include <stdbool.h>
+#include "../vehicle/vehicle.h"
+
+// Space-time reservation table: which vehicle holds tile (x,y) at tick t
+// of the current planning window (t = 0 is now, t = window is the last
+// tick planned). Entries are valid only where stamp == generation, so
+// clearing the table for the next tick is O(1).
+typedef struct
+{
+    int width;
+    int height;
+    int window;
+    unsigned int generation;
+    unsigned int *stamp;   // [(t * height + y) * width + x]
+    const Vehicle **owner;
+} ReservationTable;
+
+// Allocate a table for a width x height map and ticks 0..window. False on OOM.
+bool reservation_init(ReservationTable *rt, int width, int height, int window);
+void reservation_free(ReservationTable *rt);
+
+// Drop every reservation
+void reservation_clear(ReservationTable *rt);
+
+// Holder of (x,y) at tick t, NULL if free or outside the table
+const Vehicle *reservation_owner(const ReservationTable *rt, int x, int y, int t);
+
+// Reserve the opaque tiles of spr anchored at (x,y) for tick t.
+// Tiles outside the map or the window are ignored.
+void reservation_reserve_sprite(ReservationTable *rt, const Sprite *spr,
+                                int x, int y, int t, const Vehicle *owner);
+
+// Give up owner's tiles of spr anchored at (x,y) at tick t
+void reservation_release_sprite(ReservationTable *rt, const Sprite *spr,
+                                int x, int y, int t, const Vehicle *owner);
+
+// True if no other vehicle holds a tile of spr anchored at (x,y) at tick t
+bool reservation_sprite_free(const ReservationTable *rt, const Sprite *spr,
+                             int x, int y, int t, const Vehicle *self);
+
+#endif // RESERVATION_H
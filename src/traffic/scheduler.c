@@ -0,0 +1,125 @@
+#include "scheduler.h"
+
+#include <stdlib.h>
+
+typedef struct
+{
+    uint64_t due_ms;
+    unsigned long seq; // breaks ties in scheduling order
+    Vehicle *v;
+} WakeEntry;
+
+static WakeEntry *g_heap = NULL;
+static int g_size = 0;
+static int g_capacity = 0;
+static unsigned long g_seq = 0;
+
+static bool entry_before(const WakeEntry *a, const WakeEntry *b)
+{
+    return a->due_ms < b->due_ms || (a->due_ms == b->due_ms && a->seq < b->seq);
+}
+
+static void heap_set(int i, WakeEntry e)
+{
+    g_heap[i] = e;
+    e.v->cold->wake_slot = i;
+}
+
+static void sift_up(int i)
+{
+    WakeEntry e = g_heap[i];
+    while (i > 0)
+    {
+        int parent = (i - 1) / 2;
+        if (!entry_before(&e, &g_heap[parent]))
+            break;
+        heap_set(i, g_heap[parent]);
+        i = parent;
+    }
+    heap_set(i, e);
+}
+
+static void sift_down(int i)
+{
+    WakeEntry e = g_heap[i];
+    for (;;)
+    {
+        int child = 2 * i + 1;
+        if (child >= g_size)
+            break;
+        if (child + 1 < g_size && entry_before(&g_heap[child + 1], &g_heap[child]))
+            child++;
+        if (!entry_before(&g_heap[child], &e))
+            break;
+        heap_set(i, g_heap[child]);
+        i = child;
+    }
+    heap_set(i, e);
+}
+
+// Remove the entry in slot i
+static void heap_remove(int i)
+{
+    g_heap[i].v->cold->wake_slot = -1;
+    if (--g_size == i)
+        return;
+    // The last entry fills the hole and moves up or down from there
+    heap_set(i, g_heap[g_size]);
+    if (i > 0 && entry_before(&g_heap[i], &g_heap[(i - 1) / 2]))
+        sift_up(i);
+    else
+        sift_down(i);
+}
+
+bool scheduler_add(Vehicle *v, uint64_t due_ms)
+{
+    scheduler_cancel(v);
+    if (g_size == g_capacity)
+    {
+        int cap = g_capacity ? g_capacity * 2 : 64;
+        WakeEntry *grown = realloc(g_heap, cap * sizeof(WakeEntry));
+        if (!grown)
+            return false;
+        g_heap = grown;
+        g_capacity = cap;
+    }
+    g_heap[g_size] = (WakeEntry){due_ms, g_seq++, v};
+    sift_up(g_size++);
+    return true;
+}
+
+void scheduler_cancel(Vehicle *v)
+{
+    int slot = v->cold->wake_slot;
+    if (slot >= 0 && slot < g_size && g_heap[slot].v == v)
+        heap_remove(slot);
+}
+
+Vehicle *scheduler_pop_due(uint64_t now_ms)
+{
+    if (g_size == 0 || g_heap[0].due_ms > now_ms)
+        return NULL;
+    Vehicle *v = g_heap[0].v;
+    heap_remove(0);
+    return v;
+}
+
+uint64_t scheduler_next_due(void)
+{
+    return g_size ? g_heap[0].due_ms : UINT64_MAX;
+}
+
+int scheduler_count(void)
+{
+    return g_size;
+}
+
+void scheduler_free(void)
+{
+    for (int i = 0; i < g_size; ++i)
+        g_heap[i].v->cold->wake_slot = -1;
+    free(g_heap);
+    g_heap = NULL;
+    g_size = 0;
+    g_capacity = 0;
+}
@@ -0,0 +1,28 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../vehicle/vehicle.h"
+
+// Wakeups for vehicles that sit idle until a deadline (parked cars until
+// they leave). Sleeping vehicles are not in the active set of their list,
+// so nothing touches them per tick; the earliest deadline is at the top of
+// a min-heap. Each vehicle is scheduled at most once (v->cold->wake_slot).
+
+// Schedule v to wake at due_ms (reschedules it if already queued).
+// Returns false on OOM.
+bool scheduler_add(Vehicle *v, uint64_t due_ms);
+// Take v out of the schedule (no-op if it is not queued)
+void scheduler_cancel(Vehicle *v);
+
+// Remove and return the vehicle with the earliest deadline <= now_ms
+// (ties: scheduled first), NULL if nobody is due
+Vehicle *scheduler_pop_due(uint64_t now_ms);
+// Earliest deadline queued, UINT64_MAX if none
+uint64_t scheduler_next_due(void);
+int scheduler_count(void);
+
+void scheduler_free(void);
+
+#endif // SCHEDULER_H
@@ -1,38 +1,73 @@
 #include "../common/debug.h"
 #include "traffic.h"
+#include "../path/path_batch.h"
+#include "../path/path_cache.h"
+#include "cooperative.h"
+#include "scheduler.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+
+static int g_coop_window = 0;
+static TrafficStats g_stats;
+static int g_min_parking_sec = 0;
+static int g_max_parking_sec = 0;
+
+void traffic_set_parking_time(int min_sec, int max_sec)
+{
+    g_min_parking_sec = min_sec;
+    g_max_parking_sec = max_sec < min_sec ? min_sec : max_sec;
+}
+
+void traffic_set_cooperative(int window)
+{
+    g_coop_window = window;
+}
+
+void traffic_note_exit(void)
+{
+    g_stats.exited++;
+}
+
+void traffic_note_idle_ticks(unsigned long ticks)
+{
+    g_stats.ticks += ticks;
+}
+
+const TrafficStats *traffic_get_stats(void)
+{
+    return &g_stats;
+}
 
 // Helper: set default route 1..N for a single vehicle
-static void vehicle_set_default_route(Vehicle *v, int num_waypoints)
+static void vehicle_set_default_route(VehicleCold *c, int num_waypoints)
 {
-    v->route_length = num_waypoints;
-    v->route_pos = 0;
+    c->route_length = num_waypoints;
+    c->route_pos = 0;
 
-    if (v->route_length > MAX_ROUTE_WAYPOINTS)
-        v->route_length = MAX_ROUTE_WAYPOINTS;
+    if (c->route_length > MAX_ROUTE_WAYPOINTS)
+        c->route_length = MAX_ROUTE_WAYPOINTS;
 
-    for (int i = 0; i < v->route_length; ++i)
-        v->route[i] = i + 1; // waypoint IDs: 1,2,3,...
+    for (int i = 0; i < c->route_length; ++i)
+        c->route[i] = i + 1; // waypoint IDs: 1,2,3,...
 }
 
 // Helper: plan path from vehicle's current pos to current route waypoint
 static void vehicle_plan_path_to_current_waypoint(Vehicle *v, Map *map)
 {
-    if (v->route_length == 0 || v->route_pos >= v->route_length)
+    VehicleCold *c = v->cold;
+    if (c->route_length == 0 || c->route_pos >= c->route_length)
         return;
 
-    int target_id = v->route[v->route_pos];
+    int target_id = c->route[c->route_pos];
     const Waypoint *w = map_get_waypoint_by_id(map, target_id);
     if (!w)
         return;
 
-    Path p;
-    path_init(&p);
-
-    if (path_find(map, v->x, v->y, w->x, w->y, &p))
+    const Path *p = path_cache_find(map, v->x, v->y, w->x, w->y, 1, 1);
+    if (p)
     {
-        vehicle_set_path(v, &p);
+        vehicle_set_path(v, p);
     }
     else
     {
@@ -40,21 +75,43 @@ static void vehicle_plan_path_to_current_waypoint(Vehicle *v, Map *map)
     }
 }
 
+// Batched next-leg result: follow it if there is one
+static void vehicle_apply_leg_path(void *user, const Path *p)
+{
+    if (p)
+        vehicle_set_path((Vehicle *)user, p);
+}
+
 void traffic_init_vehicle_route(Vehicle *v, Map *map)
 {
     int num_waypoints = map->waypoint_count;
     if (num_waypoints <= 0)
         return;
 
-    vehicle_set_default_route(v, num_waypoints);
+    vehicle_set_default_route(v->cold, num_waypoints);
     vehicle_plan_path_to_current_waypoint(v, map);
 }
 
-void traffic_step(VehicleList *list, Map *map)
+// v just parked: draw its parking time and let it sleep until then
+static void vehicle_start_parking(VehiclePool *pool, Vehicle *v, uint64_t now_ms)
 {
-    for (VehicleNode *node = list->head; node; node = node->next)
+    VehicleCold *c = v->cold;
+    c->parking_time_sec = g_min_parking_sec + rand() % (g_max_parking_sec - g_min_parking_sec + 1);
+    c->parking_start_time_ms = now_ms;
+    debug_log("[traffic] Vehicle parked for %d s, start_time_ms: %llu\n",
+              c->parking_time_sec, (unsigned long long)now_ms);
+    if (scheduler_add(v, now_ms + (uint64_t)c->parking_time_sec * 1000))
+        vehicle_pool_sleep(pool, v);
+}
+
+void traffic_step(VehiclePool *pool, Map *map, uint64_t now_ms)
+{
+    int count;
+    Vehicle *const *active = vehicle_pool_active(pool, &count);
+    for (int i = 0; i < count; ++i)
     {
-        Vehicle *v = &node->vehicle;
+        Vehicle *v = active[i]; // may go to sleep below
+        VehicleCold *c = v->cold; // only touched once the hot fields say so
 
         // Parking logic
         // Only consider parking if not already parking or parked
@@ -64,117 +121,109 @@ void traffic_step(VehicleList *list, Map *map)
             ParkingSpot *spot = traffic_find_near_free_spot(v, map, 12);
             if (spot && !spot->occupied) {
                 v->going_to_parking = 1;
-                v->parking_spot_id = spot->id;
-                v->assigned_spot = spot;
-                spot->occupied = 1;
-                spot->occupant = v;
+                c->parking_spot_id = spot->id;
+                c->assigned_spot = spot;
+                map_occupy_spot(map, spot, v);
                 debug_log("[traffic] Assigned parking spot id=%d anchor=(%d,%d) size=%dx%d\n", spot->id, spot->x0, spot->y0, spot->width, spot->height);
                 // Primary: drive to the spot's anchor (upper-left of the block)
-                Path p;
-                path_init(&p);
                 const Sprite *spr = vehicle_get_sprite(v);
                 int car_w = spr->width;
                 int car_h = spr->height;
                 int found = 0;
                 debug_log("[traffic] Attempt path to spot anchor (%d,%d)\n", spot->x0, spot->y0);
-                if (path_find_with_size(map, v->x, v->y, spot->x0, spot->y0, car_w, car_h, &p)) {
-                    vehicle_set_path(v, &p);
+                const Path *anchor_path = path_cache_find(map, v->x, v->y, spot->x0, spot->y0, car_w, car_h);
+                if (anchor_path) {
+                    debug_log("[traffic] Anchor path success: length=%d\n", anchor_path->length);
+                    vehicle_set_path(v, anchor_path);
                     v->state = VEH_PARKING;
-                    debug_log("[traffic] Anchor path success: length=%d\n", p.length);
                     found = 1;
                 } else {
-                    // Fallback: try any valid position inside the parking area
-                    debug_log("[traffic] Anchor path failed; scanning inside spot for alternative positions\n");
-                    for (int py = spot->y0; py <= spot->y0 + spot->height - car_h; ++py) {
-                        for (int px = spot->x0; px <= spot->x0 + spot->width - car_w; ++px) {
-                            if (path_find_with_size(map, v->x, v->y, px, py, car_w, car_h, &p)) {
-                                vehicle_set_path(v, &p);
-                                v->state = VEH_PARKING;
-                                debug_log("[traffic] Fallback path success to (%d,%d): length=%d\n", px, py, p.length);
-                                found = 1;
-                                break;
-                            }
-                        }
-                        if (found) break;
+                    // Fallback: cheapest valid position inside the parking area, one search
+                    debug_log("[traffic] Anchor path failed; searching inside spot for alternative positions\n");
+                    const Path *p = path_find_to_rect(map, v->x, v->y,
+                                                      spot->x0, spot->y0,
+                                                      spot->x0 + spot->width - car_w,
+                                                      spot->y0 + spot->height - car_h,
+                                                      car_w, car_h);
+                    if (p) {
+                        debug_log("[traffic] Fallback path success: length=%d\n", p->length);
+                        vehicle_set_path(v, p);
+                        v->state = VEH_PARKING;
+                        found = 1;
                     }
                 }
                 if (!found) {
                     // If no path, give up parking for now
                     debug_log("[traffic] No valid path into spot id=%d; releasing reservation\n", spot->id);
                     v->going_to_parking = 0;
-                    v->parking_spot_id = -1;
-                    v->assigned_spot = NULL;
-                    spot->occupied = 0;
-                    spot->occupant = NULL;
+                    c->parking_spot_id = -1;
+                    c->assigned_spot = NULL;
+                    map_release_spot(map, spot);
                 }
             }
         }
 
-        // 
-        if (v->going_to_parking && v->parking_spot_id >= 0 && v->assigned_spot) {
-            ParkingSpot *spot = v->assigned_spot;
+        // A vehicle still on its path can neither have parked nor reached
+        // its waypoint; check that before looking at the cold part
+        if (v->going_to_parking && !v->has_path && v->state != VEH_PARKED &&
+            c->parking_spot_id >= 0 && c->assigned_spot) {
+            ParkingSpot *spot = c->assigned_spot;
             // Consider parked when vehicle's anchor reaches the spot's anchor
-            int parked = (v->x == spot->x0 && v->y == spot->y0);
-            if (parked && !v->has_path) {
+            if (v->x == spot->x0 && v->y == spot->y0) {
                 v->state = VEH_PARKED;
-                spot->occupied = 1;
-                spot->occupant = v;
+                map_occupy_spot(map, spot, v);
                 debug_log("[traffic] Vehicle parked at spot id=%d anchor=(%d,%d)\n", spot->id, spot->x0, spot->y0);
+                vehicle_start_parking(pool, v, now_ms);
+                continue;
             }
         }
 
         // --- PARKING LEAVE LOGIC ---
-        if (v->state == VEH_LEAVING && v->assigned_spot) {
-            ParkingSpot *spot = v->assigned_spot;
-            spot->occupied = 0;
-            spot->occupant = NULL;
-            v->assigned_spot = NULL;
-            v->parking_spot_id = -1;
+        if (v->state == VEH_LEAVING && c->assigned_spot) {
+            map_release_spot(map, c->assigned_spot);
+            c->assigned_spot = NULL;
+            c->parking_spot_id = -1;
         }
 
         // Waypoint-following logic (if not parking)
-        if (!v->going_to_parking && v->route_length > 0 && v->route_pos < v->route_length) {
-            int target_id = v->route[v->route_pos];
+        if (!v->going_to_parking && !v->has_path && c->route_pos < c->route_length) {
+            int target_id = c->route[c->route_pos];
             const Waypoint *w = map_get_waypoint_by_id(map, target_id);
-            if (w) {
-                const Sprite *spr = vehicle_get_sprite(v);
-                int reached = 0;
-                for (int sy = 0; sy < spr->height && !reached; ++sy) {
-                    for (int sx = 0; sx < spr->width && !reached; ++sx) {
-                        char c = spr->rows[sy][sx];
-                        if (c == ' ') continue;
-                        int tx = v->x + sx;
-                        int ty = v->y + sy;
-                        if (tx == w->x && ty == w->y) {
-                            reached = 1;
-                        }
-                    }
-                }
-                if (reached && !v->has_path) {
-                    v->route_pos++;
-                    if (v->route_pos < v->route_length) {
-                        // Plan path to next waypoint
-                        int next_id = v->route[v->route_pos];
-                        const Waypoint *next_w = map_get_waypoint_by_id(map, next_id);
-                        if (next_w) {
-                            Path p;
-                            path_init(&p);
-                            if (path_find(map, v->x, v->y, next_w->x, next_w->y, &p)) {
-                                vehicle_set_path(v, &p);
-                            }
-                        }
+            // Reached when an opaque tile of the car covers the waypoint
+            if (w && sprite_covers(vehicle_get_sprite(v), w->x - v->x, w->y - v->y)) {
+                c->route_pos++;
+                if (c->route_pos < c->route_length) {
+                    // Plan path to next waypoint
+                    int next_id = c->route[c->route_pos];
+                    const Waypoint *next_w = map_get_waypoint_by_id(map, next_id);
+                    if (next_w) {
+                        path_batch_add(map, v->x, v->y, next_w->x, next_w->y, 1, 1,
+                                       vehicle_apply_leg_path, v);
                     }
                 }
             }
         }
     }
 
+    // Plan all next legs of this tick together
+    path_batch_flush(map);
+
     // Move everyone + collision control
-    vehicles_update_all(list, map);
+    if (g_coop_window > 0)
+        g_stats.blocked += cooperative_update_all(pool, map, g_coop_window);
+    else
+        g_stats.blocked += vehicles_update_all(pool, map);
+    g_stats.ticks++;
 }
 
 ParkingSpot *traffic_find_near_free_spot(Vehicle *v, Map *map, int radius)
 {
+    if (map->free_spot_count == 0)
+    {
+        debug_log("[traffic] No free parking spots available\n");
+        return NULL;
+    }
+
     ParkingSpot *best = NULL;
     int best_d2 = 999999;
 
@@ -185,44 +234,44 @@ ParkingSpot *traffic_find_near_free_spot(Vehicle *v, Map *map, int radius)
     int vx1 = vx0 + spr->width - 1;
     int vy1 = vy0 + spr->height - 1;
 
-    for (int i = 0; i < map->parking_count; ++i)
+    // Only spots in the buckets around the bbox can be within the radius;
+    // bits come out in id order, so ties go to the lowest id as before
+    uint64_t near[SPOT_MASK_WORDS];
+    map_free_spots_near(map, vx0 - radius, vy0 - radius, vx1 + radius, vy1 + radius, near);
+    for (int w = 0; w < SPOT_MASK_WORDS; ++w)
     {
-        ParkingSpot *p = &map->parkings[i];
-
-        if (p->occupied)
-            continue;
-
-        // Parking area bounding box
-        int px0 = p->x0;
-        int py0 = p->y0;
-        int px1 = px0 + p->width - 1;
-        int py1 = py0 + p->height - 1;
-
-        // Compute minimal squared distance between vehicle bbox and parking bbox
-        int dx = 0, dy = 0;
-        if (vx1 < px0)
-            dx = px0 - vx1;
-        else if (vx0 > px1)
-            dx = vx0 - px1;
-        else
-            dx = 0;
-
-        if (vy1 < py0)
-            dy = py0 - vy1;
-        else if (vy0 > py1)
-            dy = vy0 - py1;
-        else
-            dy = 0;
-
-        int dist2 = dx * dx + dy * dy;
-
-        if (dist2 <= radius * radius)
+        for (uint64_t bits = near[w]; bits; bits &= bits - 1)
         {
-            debug_log("[traffic] Spot id=%d within radius: dist2=%d (occupied=%d)\n", p->id, dist2, p->occupied);
-            if (dist2 < best_d2)
+            ParkingSpot *p = &map->parkings[w * 64 + __builtin_ctzll(bits)];
+
+            // Parking area bounding box
+            int px0 = p->x0;
+            int py0 = p->y0;
+            int px1 = px0 + p->width - 1;
+            int py1 = py0 + p->height - 1;
+
+            // Compute minimal squared distance between vehicle bbox and parking bbox
+            int dx = 0, dy = 0;
+            if (vx1 < px0)
+                dx = px0 - vx1;
+            else if (vx0 > px1)
+                dx = vx0 - px1;
+
+            if (vy1 < py0)
+                dy = py0 - vy1;
+            else if (vy0 > py1)
+                dy = vy0 - py1;
+
+            int dist2 = dx * dx + dy * dy;
+
+            if (dist2 <= radius * radius)
             {
-                best = p;
-                best_d2 = dist2;
+                debug_log("[traffic] Spot id=%d within radius: dist2=%d (occupied=%d)\n", p->id, dist2, p->occupied);
+                if (dist2 < best_d2)
+                {
+                    best = p;
+                    best_d2 = dist2;
+                }
             }
         }
     }
@@ -233,34 +282,32 @@ ParkingSpot *traffic_find_near_free_spot(Vehicle *v, Map *map, int radius)
 
     // Fallback: pick globally nearest free spot regardless of radius
     best_d2 = 999999;
-    for (int i = 0; i < map->parking_count; ++i)
+    for (int w = 0; w < SPOT_MASK_WORDS; ++w)
     {
-        ParkingSpot *p = &map->parkings[i];
-
-        if (p->occupied)
-            continue;
+        for (uint64_t bits = map->spot_free[w]; bits; bits &= bits - 1)
+        {
+            ParkingSpot *p = &map->parkings[w * 64 + __builtin_ctzll(bits)];
 
-        // measure by anchor distance to favor intended target
-        int dx = p->x0 - v->x;
-        int dy = p->y0 - v->y;
-        int dist2 = dx * dx + dy * dy;
+            // measure by anchor distance to favor intended target
+            int dx = p->x0 - v->x;
+            int dy = p->y0 - v->y;
+            int dist2 = dx * dx + dy * dy;
 
-        if (dist2 < best_d2)
-        {
-            best = p;
-            best_d2 = dist2;
+            if (dist2 < best_d2)
+            {
+                best = p;
+                best_d2 = dist2;
+            }
         }
     }
     if (best)
         debug_log("[traffic] No spot within radius=%d; selecting global nearest id=%d (dist2=%d)\n", radius, best->id, best_d2);
-    else
-        debug_log("[traffic] No free parking spots available\n");
     return best;
 }
 
 void traffic_update_parking_states(Vehicle *v, Map *map)
 {
-    if (!v->going_to_parking || v->parking_spot_id < 0)
+    if (!v->going_to_parking || v->cold->parking_spot_id < 0)
         return;
 
     if (v->has_path) // still moving
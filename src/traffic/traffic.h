@@ -3,15 +3,40 @@
 
 #include "../map/map.h"
 #include "../vehicle/vehicle.h"
-#include "../vehicle/vehicle_list.h"
+#include "../vehicle/vehicle_pool.h"
 #include "../path/path.h"
 
+// Counters for comparing movers (see traffic_set_cooperative)
+typedef struct
+{
+    unsigned long ticks;
+    unsigned long blocked; // vehicle-ticks spent blocked with a path ahead
+    unsigned long exited;  // vehicles that left the lot
+} TrafficStats;
+
 void traffic_init_vehicle_route(Vehicle *v, Map *map);
 
-// One simulation step:
-// 1. move all vehicles along their current paths (with collisions)
+// Mover used by traffic_step: 0 = greedy vehicles_update_all (default),
+// otherwise cooperative_update_all with a reservation window of that
+// many ticks
+void traffic_set_cooperative(int window);
+
+// Parking time drawn for each vehicle when it parks, in seconds
+void traffic_set_parking_time(int min_sec, int max_sec);
+
+// Record a vehicle leaving the lot
+void traffic_note_exit(void);
+// Record ticks skipped because traffic_step would have had nothing to do
+void traffic_note_idle_ticks(unsigned long ticks);
+const TrafficStats *traffic_get_stats(void);
+
+// One simulation step over the active vehicles at time now_ms:
+// 1. assign parking spots; a vehicle that parks draws its parking time
+//    and sleeps until its departure deadline (see scheduler.h)
 // 2. for vehicles that finished a path but still have waypoints, plan the next path
-void traffic_step(VehicleList *vehicles, Map *map);
+//    (batched, see path_batch_flush)
+// 3. move all active vehicles along their current paths (with collisions)
+void traffic_step(VehiclePool *vehicles, Map *map, uint64_t now_ms);
 
 ParkingSpot *traffic_find_near_free_spot(Vehicle *v, Map *map, int radius);
 void traffic_update_parking_states(Vehicle *v, Map *map);
@@ -13,6 +13,47 @@ static int g_sprites_loaded = 0;
 #define CAR_SMALL_VERTICAL_WIDTH 3
 #define CAR_SMALL_VERTICAL_HEIGHT 3
 
+// Precompute the footprint forms of a loaded sprite: row masks (for
+// shift-and-mask tests), bounding box and the list of opaque cells
+static int compile_sprite(Sprite *spr)
+{
+    if (spr->width > 64 || spr->height > 127)
+        return 0;
+    spr->row_masks = calloc(spr->height, sizeof(uint64_t));
+    spr->cells = malloc(spr->width * spr->height * sizeof(SpriteCell));
+    if (!spr->row_masks || !spr->cells)
+    {
+        free(spr->row_masks);
+        free(spr->cells);
+        spr->row_masks = NULL;
+        spr->cells = NULL;
+        return 0;
+    }
+
+    spr->cell_count = 0;
+    spr->min_x = spr->width;
+    spr->min_y = spr->height;
+    spr->max_x = -1;
+    spr->max_y = -1;
+    for (int y = 0; y < spr->height; ++y)
+    {
+        for (int x = 0; x < spr->width; ++x)
+        {
+            char c = spr->rows[y][x];
+            if (c == ' ')
+                continue;
+            spr->row_masks[y] |= (uint64_t)1 << x;
+            spr->cells[spr->cell_count++] = (SpriteCell){(int8_t)x, (int8_t)y, c};
+            if (x < spr->min_x) spr->min_x = x;
+            if (x > spr->max_x) spr->max_x = x;
+            if (y < spr->min_y) spr->min_y = y;
+            if (y > spr->max_y) spr->max_y = y;
+        }
+    }
+    spr->solid = spr->cell_count == spr->width * spr->height;
+    return 1;
+}
+
 static int load_sprite_from_file(Sprite *spr,
                                  const char *filepath,
                                  int width,
@@ -85,8 +126,17 @@ static int load_sprite_from_file(Sprite *spr,
         // Copy the first "width" characters from the line
         memcpy(spr->rows[y], buffer, width);
     }
-
     fclose(f);
+
+    if (!compile_sprite(spr))
+    {
+        debug_log("Sprite file %s: cannot compile footprint\n", filepath);
+        for (int k = 0; k < height; ++k)
+            free(spr->rows[k]);
+        free(spr->rows);
+        spr->rows = NULL;
+        return 0;
+    }
     return 1;
 }
 
@@ -153,43 +203,58 @@ void vehicle_init(Vehicle *v, int x, int y, Direction dir)
     v->x = x;
     v->y = y;
     v->dir = dir;
+    v->state = VEH_DRIVING;
     v->sprites = vehicle_sprites_get_default();
 
-    path_init(&v->path);
-    v->path_index = 0;
+    v->path = NULL;
+    path_iter_init(&v->path_it, NULL);
     v->has_path = 0;
+    v->going_to_parking = 0;
 
-    v->route_length = 0;
-    v->route_pos = 0;
+    v->id = 0;
+    v->occ_spr = NULL;
+    v->cold = NULL;
+}
 
-    v->state = VEH_DRIVING;
-    v->parking_spot_id = -1;
-    v->going_to_parking = 0;
+void vehicle_cold_init(VehicleCold *c)
+{
+    memset(c, 0, sizeof(*c));
+    c->assigned_spot = NULL;
+    c->parking_spot_id = -1;
+    c->wake_slot = -1;
 }
 
 void vehicle_set_path(Vehicle *v, const Path *p)
 {
-    // Copy path struct by value
-    v->path = *p;
+    // Share the path instead of copying it
+    path_release(v->path);
+    v->path = p;
 
-    if (v->path.length > 0)
+    path_iter_init(&v->path_it, p);
+    if (v->path && v->path->length > 0)
     {
         // Place vehicle at first step (start of path)
-        v->x = v->path.steps[0].x;
-        v->y = v->path.steps[0].y;
-        v->path_index = 1; // next goal is step 1
-        v->has_path = (v->path.length > 1);
+        v->x = v->path->start_x;
+        v->y = v->path->start_y;
+        v->has_path = path_iter_has_next(&v->path_it);
     }
     else
     {
         v->has_path = 0;
-        v->path_index = 0;
     }
 }
 
-const Sprite *vehicle_get_sprite(const Vehicle *v)
+void vehicle_clear_path(Vehicle *v)
 {
-    switch (v->dir)
+    path_release(v->path);
+    v->path = NULL;
+    v->has_path = 0;
+    path_iter_init(&v->path_it, NULL);
+}
+
+const Sprite *vehicle_get_sprite_for_dir(const Vehicle *v, Direction dir)
+{
+    switch (dir)
     {
     case DIR_NORTH:
         return &v->sprites->north;
@@ -201,4 +266,9 @@ const Sprite *vehicle_get_sprite(const Vehicle *v)
         return &v->sprites->west;
     }
     return &v->sprites->east;
+}
+
+const Sprite *vehicle_get_sprite(const Vehicle *v)
+{
+    return vehicle_get_sprite_for_dir(v, v->dir);
 }
\ No newline at end of file
@@ -16,16 +16,44 @@ typedef enum
     VEH_PARKING,
     VEH_PARKED,
     VEH_LEAVING,
-    VEH_EXIT_QUEUE
+    VEH_EXIT_QUEUE,
+    VEH_REMOVED // left the lot, despawned at the end of the tick
 } VehicleState;
 
+// One opaque tile of a sprite, relative to its anchor
+typedef struct
+{
+    int8_t dx;
+    int8_t dy;
+    char glyph;
+} SpriteCell;
+
+// Sprites are compiled once when loaded; hot loops use the masks, the
+// bounding box or the cell list instead of scanning rows for ' '
 typedef struct
 {
     int width;
     int height;
     char **rows; // rows[height][width], ' ' = transparent
+    uint64_t *row_masks; // bit x of row_masks[y] set = rows[y][x] opaque (width <= 64)
+    // Bounding box of the opaque tiles (inclusive, relative to the anchor)
+    int min_x, min_y, max_x, max_y;
+    // Opaque tiles in row-major order
+    SpriteCell *cells;
+    int cell_count;
+    // Every tile opaque (carSmall east/west): the footprint is the plain
+    // width x height rectangle
+    bool solid;
 } Sprite;
 
+// True if the tile (dx,dy) from the anchor is an opaque tile of spr
+static inline bool sprite_covers(const Sprite *spr, int dx, int dy)
+{
+    if (dx < spr->min_x || dx > spr->max_x || dy < spr->min_y || dy > spr->max_y)
+        return false;
+    return (spr->row_masks[dy] >> dx) & 1;
+}
+
 // A set of sprites for all 4 directions
 typedef struct
 {
@@ -35,34 +63,48 @@ typedef struct
     Sprite west;
 } VehicleSprites;
 
-typedef struct Vehicle
+// Bookkeeping only looked at when a vehicle changes leg, parks or leaves.
+// Kept out of Vehicle so the per-tick loops do not drag it through the
+// cache; the pool stores it in chunks of its own.
+typedef struct VehicleCold
 {
-    int x;
-    int y;
-    Direction dir;
-    const VehicleSprites *sprites; // pointer to shared sprites
-    // Car follows route across waypoints
-    // It reaches every waypoint with a path
-    Path path;
-    int path_index; // index of next step in path
-    int has_path;
     int parking_time_sec; // Fixed parking time (seconds)
-    int parking_time_remaining; // Live countdown (ms)
-    uint64_t parking_start_time_ms; // Real wall clock start time (ms since epoch)
+    uint64_t parking_start_time_ms; // Simulation clock when it parked (Sim.now_ms)
 
+    // Car follows route across waypoints
     int route[MAX_ROUTE_WAYPOINTS]; // sequence of waypoint IDs
     int route_length;
     int route_pos; // index into route[]
 
-    VehicleState state;
-
     struct ParkingSpot *assigned_spot;
     bool wants_parking;
 
     int parking_spot_id;  // -1 = none
-    int going_to_parking; // bool-ish
     int parking_time; // ms parked (reset when not parked)
     int reverse_steps_remaining; // for backing out
+    int wake_slot; // position in the wakeup schedule, -1 = not scheduled
+} VehicleCold;
+
+// What moving and colliding touch every tick
+typedef struct Vehicle
+{
+    int x;
+    int y;
+    Direction dir;
+    VehicleState state;
+    int has_path;
+    int going_to_parking; // bool-ish
+    const VehicleSprites *sprites; // pointer to shared sprites
+    // It reaches every waypoint with a path (shared, read-only, NULL = none)
+    const Path *path;
+    PathIter path_it; // current position along path
+    // Id in the list's occupancy grid and the footprint stamped there
+    // (occ_spr NULL = not stamped yet)
+    uint16_t id;
+    const Sprite *occ_spr;
+    int occ_x;
+    int occ_y;
+    VehicleCold *cold; // NULL until spawned into a pool
 } Vehicle;
 
 // Initialize global/default vehicle sprites from 4 txt files
@@ -70,12 +112,21 @@ typedef struct Vehicle
 bool vehicle_sprites_init(const char *base_path);
 const VehicleSprites *vehicle_sprites_get_default(void);
 
-// Initialize a vehicle at (x, y) with direction and glyph (e.g. 'C')
+// Initialize a vehicle at (x, y) with direction and glyph (e.g. 'C').
+// The cold part comes with the pool slot (see vehicle_pool_spawn).
 void vehicle_init(Vehicle *v, int x, int y, Direction dir);
+void vehicle_cold_init(VehicleCold *c);
 
 // Get Sprite according to vehicle direction
 const Sprite *vehicle_get_sprite(const Vehicle *v);
+// Sprite the vehicle would show when facing dir
+const Sprite *vehicle_get_sprite_for_dir(const Vehicle *v, Direction dir);
 
+// Give the vehicle a shared path (see path_cache_find).
+// The vehicle takes over the caller's reference and drops its old path.
 void vehicle_set_path(Vehicle *v, const Path *p);
 
+// Drop the vehicle's path reference (call before discarding a vehicle)
+void vehicle_clear_path(Vehicle *v);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,522 @@
+#include "vehicle_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define OCC_IDX(x, y, width) ((y) * (width) + (x))
+
+static inline VehicleSlot *slot_at(const VehiclePool *pool, int i)
+{
+    return &pool->chunks[i / VEHICLE_POOL_CHUNK][i % VEHICLE_POOL_CHUNK];
+}
+
+static inline VehicleSlot *slot_of(const Vehicle *v)
+{
+    return (VehicleSlot *)v; // vehicle is the first member
+}
+
+static inline bool slot_live(const VehicleSlot *slot)
+{
+    return slot->generation & 1;
+}
+
+void vehicle_pool_init(VehiclePool *pool)
+{
+    memset(pool, 0, sizeof(*pool));
+    pool->free_head = -1;
+}
+
+// Add a chunk of free slots (lowest index first on the free list) and make
+// room for them in the iteration arrays
+static bool pool_grow(VehiclePool *pool)
+{
+    if (pool->chunk_count == VEHICLE_POOL_MAX_CHUNKS)
+        return false;
+    int capacity = (pool->chunk_count + 1) * VEHICLE_POOL_CHUNK;
+    Vehicle **live = realloc(pool->live, capacity * sizeof(Vehicle *));
+    if (!live)
+        return false;
+    pool->live = live;
+    Vehicle **active = realloc(pool->active, capacity * sizeof(Vehicle *));
+    if (!active)
+        return false;
+    pool->active = active;
+    VehicleSlot *chunk = calloc(VEHICLE_POOL_CHUNK, sizeof(VehicleSlot));
+    VehicleCold *cold = calloc(VEHICLE_POOL_CHUNK, sizeof(VehicleCold));
+    if (!chunk || !cold)
+    {
+        free(chunk);
+        free(cold);
+        return false;
+    }
+
+    int base = pool->chunk_count * VEHICLE_POOL_CHUNK;
+    for (int i = VEHICLE_POOL_CHUNK - 1; i >= 0; --i)
+    {
+        if (base + i >= OCC_MAX_ID)
+            continue; // ids are 1..OCC_MAX_ID
+        chunk[i].next_free = pool->free_head;
+        pool->free_head = base + i;
+    }
+    pool->cold_chunks[pool->chunk_count] = cold;
+    pool->chunks[pool->chunk_count++] = chunk;
+    pool->capacity = capacity;
+    return true;
+}
+
+// Drop despawned (and, for the active set, sleeping) vehicles from the
+// iteration arrays, keeping spawn order
+static void pool_compact(VehiclePool *pool)
+{
+    if (pool->live_dirty)
+    {
+        int n = 0;
+        for (int i = 0; i < pool->live_count; ++i)
+            if (slot_live(slot_of(pool->live[i])))
+                pool->live[n++] = pool->live[i];
+        pool->live_count = n;
+        pool->live_dirty = false;
+    }
+    if (pool->active_dirty)
+    {
+        int n = 0;
+        for (int i = 0; i < pool->active_count; ++i)
+        {
+            const VehicleSlot *slot = slot_of(pool->active[i]);
+            if (slot_live(slot) && !slot->asleep)
+                pool->active[n++] = pool->active[i];
+        }
+        pool->active_count = n;
+        pool->active_dirty = false;
+    }
+}
+
+Vehicle *vehicle_pool_spawn(VehiclePool *pool, const Vehicle *src)
+{
+    if (pool->free_head < 0 && !pool_grow(pool))
+        return NULL;
+    // A freed slot may still sit in the arrays; drop it before reuse
+    pool_compact(pool);
+
+    int index = pool->free_head;
+    VehicleSlot *slot = slot_at(pool, index);
+    pool->free_head = slot->next_free;
+
+    VehicleCold *cold = &pool->cold_chunks[index / VEHICLE_POOL_CHUNK][index % VEHICLE_POOL_CHUNK];
+    if (src->cold)
+        *cold = *src->cold;
+    else
+        vehicle_cold_init(cold);
+
+    slot->vehicle = *src; // copy struct by value
+    slot->vehicle.cold = cold;
+    slot->vehicle.id = (uint16_t)(index + 1);
+    slot->vehicle.occ_spr = NULL;
+    slot->generation++;
+    slot->seq = pool->next_seq++;
+    slot->next_free = -1;
+    slot->asleep = false;
+
+    pool->live[pool->live_count++] = &slot->vehicle;
+    pool->active[pool->active_count++] = &slot->vehicle;
+    return &slot->vehicle;
+}
+
+static void occ_erase(VehiclePool *pool, Vehicle *v);
+
+void vehicle_pool_despawn(VehiclePool *pool, Vehicle *v)
+{
+    VehicleSlot *slot = slot_of(v);
+    if (!slot_live(slot))
+        return;
+    occ_erase(pool, v);
+    vehicle_clear_path(v);
+
+    slot->generation++;
+    slot->asleep = false;
+    slot->next_free = pool->free_head;
+    pool->free_head = v->id - 1;
+    pool->live_dirty = true;
+    pool->active_dirty = true;
+}
+
+void vehicle_pool_free(VehiclePool *pool)
+{
+    for (int i = 0; i < pool->live_count; ++i)
+    {
+        if (slot_live(slot_of(pool->live[i])))
+            vehicle_clear_path(pool->live[i]);
+    }
+    for (int i = 0; i < pool->chunk_count; ++i)
+    {
+        free(pool->chunks[i]);
+        free(pool->cold_chunks[i]);
+    }
+    free(pool->live);
+    free(pool->active);
+    free(pool->occ);
+    vehicle_pool_init(pool);
+}
+
+VehicleHandle vehicle_pool_handle(const VehiclePool *pool, const Vehicle *v)
+{
+    (void)pool;
+    return (VehicleHandle){v->id - 1, slot_of(v)->generation};
+}
+
+Vehicle *vehicle_pool_get(const VehiclePool *pool, VehicleHandle h)
+{
+    if (h.slot < 0 || h.slot >= pool->chunk_count * VEHICLE_POOL_CHUNK)
+        return NULL;
+    VehicleSlot *slot = slot_at(pool, h.slot);
+    return slot_live(slot) && slot->generation == h.generation ? &slot->vehicle : NULL;
+}
+
+Vehicle *const *vehicle_pool_live(VehiclePool *pool, int *count)
+{
+    pool_compact(pool);
+    *count = pool->live_count;
+    return pool->live;
+}
+
+Vehicle *const *vehicle_pool_active(VehiclePool *pool, int *count)
+{
+    pool_compact(pool);
+    *count = pool->active_count;
+    return pool->active;
+}
+
+static void occ_update(VehiclePool *pool, Vehicle *v);
+
+void vehicle_pool_sleep(VehiclePool *pool, Vehicle *v)
+{
+    VehicleSlot *slot = slot_of(v);
+    if (slot->asleep)
+        return;
+    occ_update(pool, v); // sleepers are not synced, stamp where it stopped
+    slot->asleep = true;
+    pool->active_dirty = true;
+}
+
+void vehicle_pool_wake(VehiclePool *pool, Vehicle *v)
+{
+    VehicleSlot *slot = slot_of(v);
+    if (!slot->asleep)
+        return;
+    pool_compact(pool); // v must not be in the active array twice
+    slot->asleep = false;
+
+    // Back at its place in spawn order
+    int lo = 0, hi = pool->active_count;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (slot_of(pool->active[mid])->seq < slot->seq)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    memmove(&pool->active[lo + 1], &pool->active[lo],
+            (pool->active_count - lo) * sizeof(Vehicle *));
+    pool->active[lo] = v;
+    pool->active_count++;
+}
+
+bool vehicle_pool_is_asleep(const Vehicle *v)
+{
+    return slot_of(v)->asleep;
+}
+
+// Opaque tiles of sprite row `row` shifted by d: bit i is sprite column
+// i - d, i.e. the mask in the frame of a tile d left of the anchor.
+// 0 for rows outside the sprite.
+static uint64_t row_mask_shifted(const Sprite *spr, int row, int d)
+{
+    if (!spr || row < 0 || row >= spr->height || d >= 64 || d <= -64)
+        return 0;
+    uint64_t mask = spr->row_masks[row];
+    return d >= 0 ? mask << d : mask >> -d;
+}
+
+// Recompute a tile covered by several vehicles from their stamped
+// footprints, leaving out vehicle `except` (rare: only overlapping cars)
+static void occ_repair_cell(VehiclePool *pool, int x, int y, uint16_t except)
+{
+    uint16_t cell = 0;
+    for (int i = 0; i < pool->live_count; ++i)
+    {
+        const Vehicle *v = pool->live[i];
+        if (!slot_live(slot_of(v)) || v->id == except || !v->occ_spr)
+            continue;
+        if (!sprite_covers(v->occ_spr, x - v->occ_x, y - v->occ_y))
+            continue;
+        if (cell == 0)
+            cell = v->id;
+        else
+            cell |= OCC_SHARED;
+    }
+    pool->occ[OCC_IDX(x, y, pool->occ_width)] = cell;
+}
+
+// Stamp (or erase) id on the tiles of row y given by bits, bit i = x0 + i
+static void occ_row(VehiclePool *pool, int x0, int y, uint64_t bits, uint16_t id, bool stamp)
+{
+    if (y < 0 || y >= pool->occ_height)
+        return;
+    uint16_t *row = &pool->occ[y * pool->occ_width];
+    for (; bits; bits &= bits - 1)
+    {
+        int x = x0 + __builtin_ctzll(bits);
+        if (x < 0 || x >= pool->occ_width)
+            continue;
+        uint16_t *cell = &row[x];
+        if (stamp)
+        {
+            if (*cell == 0)
+                *cell = id;
+            else if ((*cell & OCC_MAX_ID) != id)
+                *cell |= OCC_SHARED;
+        }
+        else if (*cell & OCC_SHARED)
+        {
+            occ_repair_cell(pool, x, y, id);
+        }
+        else if (*cell == id)
+        {
+            *cell = 0;
+        }
+    }
+}
+
+// Move v's stamp to its current position and facing: only the tiles that
+// the old and new footprint do not share are touched
+static void occ_update(VehiclePool *pool, Vehicle *v)
+{
+    const Sprite *spr = vehicle_get_sprite(v);
+    const Sprite *old = v->occ_spr;
+    if (!pool->occ || (old == spr && v->occ_x == v->x && v->occ_y == v->y))
+        return;
+
+    int ox = v->occ_x, oy = v->occ_y;
+    // Erase first so a shared-tile repair no longer sees the old stamp
+    v->occ_spr = NULL;
+    if (old)
+    {
+        for (int sy = 0; sy < old->height; ++sy)
+        {
+            int y = oy + sy;
+            uint64_t keep = row_mask_shifted(spr, y - v->y, v->x - ox);
+            occ_row(pool, ox, y, old->row_masks[sy] & ~keep, v->id, false);
+        }
+    }
+    for (int sy = 0; sy < spr->height; ++sy)
+    {
+        int y = v->y + sy;
+        uint64_t had = old ? row_mask_shifted(old, y - oy, ox - v->x) : 0;
+        occ_row(pool, v->x, y, spr->row_masks[sy] & ~had, v->id, true);
+    }
+    v->occ_spr = spr;
+    v->occ_x = v->x;
+    v->occ_y = v->y;
+}
+
+// Remove v's stamp entirely
+static void occ_erase(VehiclePool *pool, Vehicle *v)
+{
+    const Sprite *old = v->occ_spr;
+    if (!pool->occ || !old)
+        return;
+    v->occ_spr = NULL;
+    for (int sy = 0; sy < old->height; ++sy)
+        occ_row(pool, v->occ_x, v->occ_y + sy, old->row_masks[sy], v->id, false);
+}
+
+bool vehicle_pool_sync_occupancy(VehiclePool *pool, const Map *map)
+{
+    int count;
+    if (!pool->occ || pool->occ_width != map->width || pool->occ_height != map->height)
+    {
+        free(pool->occ);
+        pool->occ = calloc((size_t)map->width * map->height, sizeof(uint16_t));
+        if (!pool->occ)
+            return false;
+        pool->occ_width = map->width;
+        pool->occ_height = map->height;
+        // Fresh grid: stamp everyone, sleeping vehicles included
+        Vehicle *const *live = vehicle_pool_live(pool, &count);
+        for (int i = 0; i < count; ++i)
+            live[i]->occ_spr = NULL;
+        for (int i = 0; i < count; ++i)
+            occ_update(pool, live[i]);
+        return true;
+    }
+    Vehicle *const *active = vehicle_pool_active(pool, &count);
+    for (int i = 0; i < count; ++i)
+        occ_update(pool, active[i]);
+    return true;
+}
+
+const Vehicle *vehicle_pool_occupant(const VehiclePool *pool, int x, int y)
+{
+    if (!pool->occ || x < 0 || y < 0 || x >= pool->occ_width || y >= pool->occ_height)
+        return NULL;
+    uint16_t id = pool->occ[OCC_IDX(x, y, pool->occ_width)] & OCC_MAX_ID;
+    return id ? &slot_at(pool, id - 1)->vehicle : NULL;
+}
+
+static bool occ_cell_has_sleeper(const VehiclePool *pool, int x, int y)
+{
+    uint16_t cell = pool->occ[OCC_IDX(x, y, pool->occ_width)];
+    if (!(cell & OCC_SHARED))
+        return cell != 0 && slot_at(pool, cell - 1)->asleep;
+    for (int i = 0; i < pool->live_count; ++i)
+    {
+        const Vehicle *v = pool->live[i];
+        const VehicleSlot *slot = slot_of(v);
+        if (slot_live(slot) && slot->asleep && v->occ_spr &&
+            sprite_covers(v->occ_spr, x - v->occ_x, y - v->occ_y))
+            return true;
+    }
+    return false;
+}
+
+bool vehicle_pool_sleepers_clear(const VehiclePool *pool, const Sprite *spr, int x, int y)
+{
+    if (!pool->occ)
+        return true;
+    for (int c = 0; c < spr->cell_count; ++c)
+    {
+        int tx = x + spr->cells[c].dx;
+        int ty = y + spr->cells[c].dy;
+        if (tx >= 0 && tx < pool->occ_width && ty >= 0 && ty < pool->occ_height &&
+            occ_cell_has_sleeper(pool, tx, ty))
+            return false;
+    }
+    return true;
+}
+
+// Width of the carSmall east/west footprint, checked with a fixed-length run
+#define CAR_RUN_WIDTH 8
+
+// True if none of n consecutive cells is held by a vehicle other than id
+// (no early exit, so fixed n unrolls into straight-line compares)
+static inline bool occ_run_clear(const uint16_t *cells, int n, uint16_t id)
+{
+    int hit = 0;
+    for (int i = 0; i < n; ++i)
+        hit |= cells[i] != 0 && cells[i] != id;
+    return !hit;
+}
+
+int vehicles_update_all(VehiclePool *pool, Map *map)
+{
+    int blocked_count = 0;
+
+    // Collisions are checked against the persistent occupancy grid; only
+    // vehicles that moved since the last tick are re-stamped
+    if (!vehicle_pool_sync_occupancy(pool, map))
+        return 0;
+    int width = pool->occ_width;
+
+    // For each awake vehicle: try to move with map + car collision
+    int count;
+    Vehicle *const *active = vehicle_pool_active(pool, &count);
+    for (int i = 0; i < count; ++i)
+    {
+        Vehicle *v = active[i];
+        const Sprite *spr = vehicle_get_sprite(v);
+        if (!spr)
+            continue;
+
+        // No path or finished path → skip movement
+        if (!v->has_path || !path_iter_has_next(&v->path_it))
+        {
+            v->has_path = 0;
+            continue;
+        }
+
+        // Next target tile from path
+        int next_x, next_y;
+        path_iter_peek(&v->path_it, &next_x, &next_y);
+
+        int dx = next_x - v->x;
+        int dy = next_y - v->y;
+
+        // Direction from path step
+        if (dx == 1 && dy == 0)
+            v->dir = DIR_EAST;
+        else if (dx == -1 && dy == 0)
+            v->dir = DIR_WEST;
+        else if (dx == 0 && dy == -1)
+            v->dir = DIR_NORTH;
+        else if (dx == 0 && dy == 1)
+            v->dir = DIR_SOUTH;
+        // If dx,dy are weird (e.g. path broken), we could bail:
+        // else { v->has_path = 0; goto re_mark_old_footprint; }
+
+        int new_x = next_x;
+        int new_y = next_y;
+
+        int blocked = 0;
+
+        // Map collision: one shift-and-mask test per sprite row
+        // (tiles off the map count as blocked)
+        if (spr->solid)
+        {
+            blocked = !map_rect_walkable(map, new_x, new_y, spr->width, spr->height);
+        }
+        else
+        {
+            for (int sy = 0; sy < spr->height && !blocked; ++sy)
+            {
+                if (!map_row_mask_walkable(map, new_x, new_y + sy, spr->row_masks[sy]))
+                    blocked = 1;
+            }
+        }
+
+        // Car–car collision at new_x,new_y (all tiles are on the map now);
+        // the vehicle's own tiles do not count
+        if (!blocked && spr->solid)
+        {
+            const uint16_t *row = &pool->occ[OCC_IDX(new_x, new_y, width)];
+            for (int sy = 0; sy < spr->height && !blocked; ++sy, row += width)
+            {
+                blocked = spr->width == CAR_RUN_WIDTH ? !occ_run_clear(row, CAR_RUN_WIDTH, v->id)
+                                                      : !occ_run_clear(row, spr->width, v->id);
+            }
+        }
+        else if (!blocked)
+        {
+            const uint16_t *origin = &pool->occ[OCC_IDX(new_x, new_y, width)];
+            for (int c = 0; c < spr->cell_count; ++c)
+            {
+                uint16_t cell = origin[spr->cells[c].dy * width + spr->cells[c].dx];
+                if (cell != 0 && cell != v->id)
+                {
+                    blocked = 1;
+                    break;
+                }
+            }
+        }
+
+        if (!blocked)
+        {
+            // Move is valid → apply it
+            v->x = new_x;
+            v->y = new_y;
+            path_iter_advance(&v->path_it);
+
+            if (!path_iter_has_next(&v->path_it))
+            {
+                v->has_path = 0; // reached goal
+            }
+        }
+        else
+        {
+            blocked_count++;
+        }
+        // Stamp the new position (and facing) for the vehicles after this one
+        occ_update(pool, v);
+    }
+    return blocked_count;
+}
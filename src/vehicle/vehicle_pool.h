@@ -0,0 +1,107 @@
+#ifndef VEHICLE_POOL_H
+#define VEHICLE_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "vehicle.h"
+
+// Occupancy cells hold a vehicle id; this bit marks a tile covered by
+// more than one vehicle (the id is then one of them)
+#define OCC_SHARED 0x8000
+#define OCC_MAX_ID 0x7FFF
+
+// Vehicles live in fixed-size chunks of slots that are never moved, so a
+// Vehicle * stays valid until the vehicle despawns. The cold part of slot
+// i sits at the same index of a parallel chunk, so hot slots pack
+// densely. Freed slots go on a free list and are reused; chunks are only
+// allocated when the pool grows past its high-water mark, so steady-state
+// spawn/despawn does not touch the heap. Slot i is vehicle id i + 1 (the
+// occupancy grid's id).
+#define VEHICLE_POOL_CHUNK 64
+#define VEHICLE_POOL_MAX_CHUNKS ((OCC_MAX_ID + VEHICLE_POOL_CHUNK - 1) / VEHICLE_POOL_CHUNK)
+
+// Reference to a vehicle that may have despawned since: resolves to NULL
+// once the slot is freed, even if it was reused
+typedef struct
+{
+    int slot;
+    uint32_t generation;
+} VehicleHandle;
+
+typedef struct
+{
+    Vehicle vehicle; // first member: a Vehicle * from the pool is its slot
+    uint32_t generation; // bumped on spawn and despawn, odd while live
+    uint32_t seq;        // spawn order
+    int next_free;       // free list link, -1 = end
+    bool asleep;
+} VehicleSlot;
+
+typedef struct
+{
+    VehicleSlot *chunks[VEHICLE_POOL_MAX_CHUNKS];
+    VehicleCold *cold_chunks[VEHICLE_POOL_MAX_CHUNKS];
+    int chunk_count;
+    int free_head; // first free slot, -1 = none
+    uint32_t next_seq;
+    // Live vehicles and the active set (those that may move or change
+    // state this tick; sleeping vehicles, parked until a deadline, are
+    // left out), both in spawn order. Despawned or sleeping vehicles are
+    // only dropped from the arrays on the next vehicle_pool_live/active
+    // call, so loops over a returned array may despawn or put to sleep
+    // the vehicle at hand (`make check` exercises this).
+    Vehicle **live;
+    Vehicle **active;
+    int live_count;
+    int active_count;
+    int capacity; // of live and active
+    bool live_dirty;
+    bool active_dirty;
+    // Occupancy grid kept across ticks: occ[y * occ_width + x] is the id of
+    // the vehicle covering the tile (0 = free). Vehicles are re-stamped only
+    // when they moved, by the delta between old and new footprint.
+    int occ_width;
+    int occ_height;
+    uint16_t *occ;
+} VehiclePool;
+
+// Initialize an empty pool
+void vehicle_pool_init(VehiclePool *pool);
+// Despawn everything and release all memory
+void vehicle_pool_free(VehiclePool *pool);
+
+// Copy src into a free slot; its cold part is copied too if it has one,
+// else reset with vehicle_cold_init. Returns the stored vehicle, NULL on
+// OOM or when all OCC_MAX_ID slots are taken.
+Vehicle *vehicle_pool_spawn(VehiclePool *pool, const Vehicle *src);
+// Free v's slot (v must be live in the pool)
+void vehicle_pool_despawn(VehiclePool *pool, Vehicle *v);
+
+VehicleHandle vehicle_pool_handle(const VehiclePool *pool, const Vehicle *v);
+// Vehicle behind h, NULL if it has despawned
+Vehicle *vehicle_pool_get(const VehiclePool *pool, VehicleHandle h);
+
+// Live vehicles / active set in spawn order; *count receives the length.
+// The array stays valid until the next spawn.
+Vehicle *const *vehicle_pool_live(VehiclePool *pool, int *count);
+Vehicle *const *vehicle_pool_active(VehiclePool *pool, int *count);
+
+// Take v out of the active set / put it back at its place in spawn order
+void vehicle_pool_sleep(VehiclePool *pool, Vehicle *v);
+void vehicle_pool_wake(VehiclePool *pool, Vehicle *v);
+bool vehicle_pool_is_asleep(const Vehicle *v);
+
+// Bring the occupancy grid up to date with the active vehicles' current
+// position and facing (allocates it on first use). Returns false on OOM.
+bool vehicle_pool_sync_occupancy(VehiclePool *pool, const Map *map);
+// Vehicle covering tile (x,y) as of the last sync, NULL if none
+const Vehicle *vehicle_pool_occupant(const VehiclePool *pool, int x, int y);
+// True if no sleeping vehicle covers an opaque tile of spr anchored at (x,y)
+bool vehicle_pool_sleepers_clear(const VehiclePool *pool, const Sprite *spr, int x, int y);
+
+// Move every active vehicle one step along its path (greedy, first come
+// first served; sleeping vehicles still block). Returns the number of
+// vehicles that had a path but were blocked.
+int vehicles_update_all(VehiclePool *pool, Map *map);
+
+#endif
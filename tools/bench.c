@@ -0,0 +1,642 @@
+// Microbenchmarks for the hot simulation paths.
+// Build with `make bench` and run ./bench from the repository root.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/map/map.h"
+#include "../src/path/path.h"
+#include "../src/path/flow_field.h"
+#include "../src/traffic/traffic.h"
+#include "../src/vehicle/vehicle_pool.h"
+#include "../src/vehicle/vehicle.h"
+
+#define BENCH_SEED 12345
+#define BENCH_QUERIES 200
+#define BENCH_GATE_TOGGLES 200
+#define BENCH_WALK_TESTS 1000000
+#define BENCH_SPOT_LOOKUPS 200000
+#define BENCH_SPOT_RADIUS 12
+#define BENCH_TICKS 100 // median of this many ticks
+
+// Footprint of carSmall facing east/west
+#define BENCH_CAR_W 8
+#define BENCH_CAR_H 2
+
+typedef struct
+{
+    int sx, sy;
+    int gx, gy;
+} BenchQuery;
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int fits(const Map *map, int x, int y, int w, int h)
+{
+    for (int dy = 0; dy < h; ++dy)
+        for (int dx = 0; dx < w; ++dx)
+            if (!map_is_walkable(map, x + dx, y + dy))
+                return 0;
+    return 1;
+}
+
+// Reference: map_is_walkable before the bitmaps (bounds, scan of both
+// gates' tiles, then the tile symbol)
+static int legacy_is_walkable(const Map *map, int x, int y)
+{
+    if (!map_in_bounds(map, x, y))
+        return 0;
+    if (!map->gate_entry.open)
+        for (int t = 0; t < map->gate_entry.tile_count; ++t)
+            if (map->gate_entry.xs[t] == x && map->gate_entry.ys[t] == y)
+                return 0;
+    if (!map->gate_exit.open)
+        for (int t = 0; t < map->gate_exit.tile_count; ++t)
+            if (map->gate_exit.xs[t] == x && map->gate_exit.ys[t] == y)
+                return 0;
+    return map->tiles[y][x].symbol == ' ';
+}
+
+static int legacy_fits(const Map *map, int x, int y, int w, int h)
+{
+    for (int dy = 0; dy < h; ++dy)
+        for (int dx = 0; dx < w; ++dx)
+            if (!legacy_is_walkable(map, x + dx, y + dy))
+                return 0;
+    return 1;
+}
+
+// Plain 1x1 BFS like path_find_ws, walkability through legacy_is_walkable.
+// Returns the number of expanded tiles.
+static long legacy_bfs(const Map *map, int *queue, unsigned char *seen, int sx, int sy, int gx, int gy)
+{
+    int width = map->width;
+    memset(seen, 0, width * map->height);
+    int head = 0, tail = 0;
+    queue[tail++] = sy * width + sx;
+    seen[sy * width + sx] = 1;
+    const int ddx[4] = {1, -1, 0, 0};
+    const int ddy[4] = {0, 0, -1, 1};
+    while (head < tail)
+    {
+        int cur = queue[head++];
+        if (cur == gy * width + gx)
+            break;
+        int cx = cur % width, cy = cur / width;
+        for (int d = 0; d < 4; ++d)
+        {
+            int nx = cx + ddx[d], ny = cy + ddy[d];
+            if (!map_in_bounds(map, nx, ny) || seen[ny * width + nx] || !legacy_is_walkable(map, nx, ny))
+                continue;
+            seen[ny * width + nx] = 1;
+            queue[tail++] = ny * width + nx;
+        }
+    }
+    return head;
+}
+
+// Reference: the open list as it was before the indexed heap
+// (linear scan for the minimum on pop and for duplicates on push)
+static int legacy_astar(const Map *map, int sx, int sy, int gx, int gy, int w, int h)
+{
+    int width = map->width;
+    int num_cells = width * map->height;
+    typedef struct { int idx; int f; } Node;
+    Node *open = malloc(num_cells * sizeof(Node));
+    int *g_score = malloc(num_cells * sizeof(int));
+    int open_size = 0;
+    int found = 0;
+    for (int i = 0; i < num_cells; ++i)
+        g_score[i] = 99999999;
+    int goal = gy * width + gx;
+    g_score[sy * width + sx] = 0;
+    open[open_size++] = (Node){sy * width + sx, abs(sx - gx) + abs(sy - gy)};
+    const int ddx[4] = {1, -1, 0, 0};
+    const int ddy[4] = {0, 0, -1, 1};
+    while (open_size > 0)
+    {
+        int m = 0;
+        for (int i = 1; i < open_size; ++i)
+            if (open[i].f < open[m].f) m = i;
+        int cur = open[m].idx;
+        open[m] = open[--open_size];
+        if (cur == goal) { found = 1; break; }
+        int cx = cur % width, cy = cur / width;
+        for (int d = 0; d < 4; ++d)
+        {
+            int nx = cx + ddx[d], ny = cy + ddy[d];
+            if (!map_in_bounds(map, nx, ny) || !fits(map, nx, ny, w, h))
+                continue;
+            int n = ny * width + nx;
+            int g = g_score[cur] + 1;
+            if (g >= g_score[n])
+                continue;
+            g_score[n] = g;
+            int f = g + abs(nx - gx) + abs(ny - gy);
+            int dup = 0;
+            for (int i = 0; i < open_size; ++i)
+                if (open[i].idx == n) { dup = 1; if (open[i].f > f) open[i].f = f; break; }
+            if (!dup)
+                open[open_size++] = (Node){n, f};
+        }
+    }
+    free(open);
+    free(g_score);
+    return found;
+}
+
+// Write a copy of src_path with every tile blown up to factor x factor tiles.
+// Waypoint digits and S/E markers are dropped so the copy stays loadable.
+static int write_scaled_map(const char *src_path, const char *dst_path, int factor)
+{
+    FILE *in = fopen(src_path, "r");
+    FILE *out = fopen(dst_path, "w");
+    if (!in || !out)
+    {
+        if (in) fclose(in);
+        if (out) fclose(out);
+        return 0;
+    }
+    char line[1024];
+    while (fgets(line, sizeof(line), in))
+    {
+        size_t len = strcspn(line, "\r\n");
+        if (len == 0)
+            continue;
+        for (size_t i = 0; i < len; ++i)
+            if ((line[i] >= '1' && line[i] <= '9') || line[i] == 'S' || line[i] == 'E')
+                line[i] = ' ';
+        for (int r = 0; r < factor; ++r)
+        {
+            for (size_t i = 0; i < len; ++i)
+                for (int c = 0; c < factor; ++c)
+                    fputc(line[i], out);
+            fputc('\n', out);
+        }
+    }
+    fclose(in);
+    fclose(out);
+    return 1;
+}
+
+// Synthetic lot: rows of 2x8 bays (like map.txt) between long aisles,
+// bays_x bays wide and bays_y double rows deep
+static int write_generated_lot(const char *dst_path, int bays_x, int bays_y)
+{
+    FILE *out = fopen(dst_path, "w");
+    if (!out)
+        return 0;
+    const int aisle = 4;
+    int width = 2 + bays_x * 10 + aisle * 2;
+    int rows = bays_y * (4 + aisle) + aisle + 2;
+    for (int y = 0; y < rows; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            char c = ' ';
+            int in_block = (y - 1 - aisle) % (4 + aisle);
+            int bay_col = (x - 1 - aisle) % 10;
+            if (y == 0 || y == rows - 1)
+                c = '_';
+            else if (x == 0 || x == width - 1)
+                c = '|';
+            else if (y > aisle && y < rows - 1 - aisle && x > aisle && x < width - 1 - aisle &&
+                     in_block >= 0 && in_block < 4 && bay_col >= 0)
+                c = bay_col < 8 ? 'P' : (bay_col == 8 ? '|' : ' ');
+            fputc(c, out);
+        }
+        fputc('\n', out);
+    }
+    fclose(out);
+    return 1;
+}
+
+// Random start/goal pairs where the footprint fits, same for every planner
+static int make_queries(const Map *map, BenchQuery *q, int n, int w, int h)
+{
+    srand(BENCH_SEED);
+    int count = 0;
+    int tries = 0;
+    while (count < n && tries < n * 10000)
+    {
+        tries++;
+        int sx = rand() % map->width, sy = rand() % map->height;
+        int gx = rand() % map->width, gy = rand() % map->height;
+        if (!fits(map, sx, sy, w, h) || !fits(map, gx, gy, w, h))
+            continue;
+        q[count++] = (BenchQuery){sx, sy, gx, gy};
+    }
+    return count;
+}
+
+static void bench_astar(const char *label, const Map *map)
+{
+    BenchQuery queries[BENCH_QUERIES];
+    int n = make_queries(map, queries, BENCH_QUERIES, BENCH_CAR_W, BENCH_CAR_H);
+    int found_new = 0, found_old = 0;
+    // Warm-up pass sizes the shared workspace and fills the path pool;
+    // the timed pass must not allocate
+    for (int i = 0; i < n; ++i)
+        path_release(path_find_with_size(map, queries[i].sx, queries[i].sy,
+                                         queries[i].gx, queries[i].gy,
+                                         BENCH_CAR_W, BENCH_CAR_H));
+    unsigned long allocs_before = path_alloc_count();
+    double t0 = now_sec();
+    for (int i = 0; i < n; ++i)
+    {
+        const Path *p = path_find_with_size(map, queries[i].sx, queries[i].sy,
+                                            queries[i].gx, queries[i].gy,
+                                            BENCH_CAR_W, BENCH_CAR_H);
+        found_new += p != NULL;
+        path_release(p);
+    }
+    double t_new = now_sec() - t0;
+    unsigned long search_allocs = path_alloc_count() - allocs_before;
+
+    t0 = now_sec();
+    for (int i = 0; i < n; ++i)
+        found_old += legacy_astar(map, queries[i].sx, queries[i].sy,
+                                  queries[i].gx, queries[i].gy,
+                                  BENCH_CAR_W, BENCH_CAR_H);
+    double t_old = now_sec() - t0;
+
+    printf("%-22s %4d queries  legacy %8.3f ms/q  current %8.3f ms/q  speedup %5.1fx  (found %d/%d, %lu allocs)\n",
+           label, n, t_old * 1000.0 / n, t_new * 1000.0 / n,
+           t_new > 0 ? t_old / t_new : 0.0, found_new, found_old, search_allocs);
+}
+
+static void bench_planners(const char *label, const Map *map)
+{
+    BenchQuery queries[BENCH_QUERIES];
+    int n = make_queries(map, queries, BENCH_QUERIES, BENCH_CAR_W, BENCH_CAR_H);
+    int *lengths = malloc(n * sizeof(int));
+    if (!lengths)
+        return;
+
+    double t[2];
+    int mismatches = 0;
+    int found = 0;
+    for (int planner = 0; planner < 2; ++planner)
+    {
+        path_set_planner(planner == 0 ? PATH_PLANNER_ASTAR : PATH_PLANNER_JPS);
+        double t0 = now_sec();
+        for (int i = 0; i < n; ++i)
+        {
+            const Path *p = path_find_with_size(map, queries[i].sx, queries[i].sy,
+                                                queries[i].gx, queries[i].gy,
+                                                BENCH_CAR_W, BENCH_CAR_H);
+            int length = p ? p->length : 0;
+            if (planner == 0)
+            {
+                lengths[i] = length;
+                found += p != NULL;
+            }
+            else if (lengths[i] != length)
+                mismatches++;
+            path_release(p);
+        }
+        t[planner] = now_sec() - t0;
+    }
+    path_set_planner(PATH_PLANNER_ASTAR);
+
+    printf("%-22s %4d queries  A* %8.3f ms/q  JPS %8.3f ms/q  speedup %5.1fx  (found %d, %d length mismatches)\n",
+           label, n, t[0] * 1000.0 / n, t[1] * 1000.0 / n,
+           t[1] > 0 ? t[0] / t[1] : 0.0, found, mismatches);
+    free(lengths);
+}
+
+// Walkability tests: legacy tile scan vs the bitmap, for one footprint
+// and per expansion of a 1x1 BFS (path_find)
+static void bench_walkability(const char *label, const Map *map)
+{
+    int *xs = malloc(BENCH_WALK_TESTS * sizeof(int));
+    int *ys = malloc(BENCH_WALK_TESTS * sizeof(int));
+    int *queue = malloc(map->width * map->height * sizeof(int));
+    unsigned char *seen = malloc(map->width * map->height);
+    if (!xs || !ys || !queue || !seen)
+        goto out;
+    srand(BENCH_SEED);
+    for (int i = 0; i < BENCH_WALK_TESTS; ++i)
+    {
+        xs[i] = rand() % map->width;
+        ys[i] = rand() % map->height;
+    }
+
+    volatile int sink = 0;
+    double t0 = now_sec();
+    for (int i = 0; i < BENCH_WALK_TESTS; ++i)
+        sink += legacy_fits(map, xs[i], ys[i], BENCH_CAR_W, BENCH_CAR_H);
+    double t_legacy = now_sec() - t0;
+    t0 = now_sec();
+    for (int i = 0; i < BENCH_WALK_TESTS; ++i)
+        sink += map_rect_walkable(map, xs[i], ys[i], BENCH_CAR_W, BENCH_CAR_H);
+    double t_bits = now_sec() - t0;
+
+    BenchQuery queries[BENCH_QUERIES];
+    int n = make_queries(map, queries, BENCH_QUERIES, 1, 1);
+    long expansions = 0;
+    t0 = now_sec();
+    for (int i = 0; i < n; ++i)
+        expansions += legacy_bfs(map, queue, seen, queries[i].sx, queries[i].sy, queries[i].gx, queries[i].gy);
+    double t_bfs_legacy = now_sec() - t0;
+    t0 = now_sec();
+    for (int i = 0; i < n; ++i)
+        path_release(path_find(map, queries[i].sx, queries[i].sy, queries[i].gx, queries[i].gy));
+    double t_bfs = now_sec() - t0;
+    (void)sink;
+
+    printf("%-22s %dx%d fit: legacy %6.1f ns  bitmap %6.1f ns  (%4.1fx)   1x1 BFS: legacy %6.1f ns/exp  current %6.1f ns/exp  (%4.1fx)\n",
+           label, BENCH_CAR_W, BENCH_CAR_H,
+           t_legacy * 1e9 / BENCH_WALK_TESTS, t_bits * 1e9 / BENCH_WALK_TESTS,
+           t_bits > 0 ? t_legacy / t_bits : 0.0,
+           expansions ? t_bfs_legacy * 1e9 / expansions : 0.0,
+           expansions ? t_bfs * 1e9 / expansions : 0.0,
+           t_bfs > 0 ? t_bfs_legacy / t_bfs : 0.0);
+out:
+    free(xs);
+    free(ys);
+    free(queue);
+    free(seen);
+}
+
+// Reference: traffic_find_near_free_spot before the spot index (bbox
+// distance over every spot, then nearest anchor over every spot)
+static ParkingSpot *legacy_find_spot(Vehicle *v, Map *map, int radius)
+{
+    const Sprite *spr = vehicle_get_sprite(v);
+    int vx0 = v->x, vy0 = v->y;
+    int vx1 = vx0 + spr->width - 1, vy1 = vy0 + spr->height - 1;
+    ParkingSpot *best = NULL;
+    int best_d2 = 999999;
+    for (int i = 0; i < map->parking_count; ++i)
+    {
+        ParkingSpot *p = &map->parkings[i];
+        if (p->occupied)
+            continue;
+        int px1 = p->x0 + p->width - 1, py1 = p->y0 + p->height - 1;
+        int dx = vx1 < p->x0 ? p->x0 - vx1 : (vx0 > px1 ? vx0 - px1 : 0);
+        int dy = vy1 < p->y0 ? p->y0 - vy1 : (vy0 > py1 ? vy0 - py1 : 0);
+        int dist2 = dx * dx + dy * dy;
+        if (dist2 <= radius * radius && dist2 < best_d2)
+        {
+            best = p;
+            best_d2 = dist2;
+        }
+    }
+    if (best)
+        return best;
+    for (int i = 0; i < map->parking_count; ++i)
+    {
+        ParkingSpot *p = &map->parkings[i];
+        if (p->occupied)
+            continue;
+        int dx = p->x0 - v->x, dy = p->y0 - v->y;
+        if (dx * dx + dy * dy < best_d2)
+        {
+            best = p;
+            best_d2 = dx * dx + dy * dy;
+        }
+    }
+    return best;
+}
+
+// Free spot lookups from random positions at a given share of taken spots
+static void bench_spot_lookup(const char *label, Map *map, int taken_pct)
+{
+    Vehicle *vs = malloc(BENCH_SPOT_LOOKUPS * sizeof(Vehicle));
+    if (!vs)
+        return;
+    srand(BENCH_SEED);
+    for (int i = 0; i < map->parking_count; ++i)
+    {
+        if (rand() % 100 < taken_pct)
+            map_occupy_spot(map, &map->parkings[i], NULL);
+        else
+            map_release_spot(map, &map->parkings[i]);
+    }
+    for (int i = 0; i < BENCH_SPOT_LOOKUPS; ++i)
+        vehicle_init(&vs[i], rand() % map->width, rand() % map->height, DIR_WEST);
+
+    volatile int sink = 0;
+    double t0 = now_sec();
+    for (int i = 0; i < BENCH_SPOT_LOOKUPS; ++i)
+        sink += legacy_find_spot(&vs[i], map, BENCH_SPOT_RADIUS) != NULL;
+    double t_legacy = now_sec() - t0;
+    t0 = now_sec();
+    for (int i = 0; i < BENCH_SPOT_LOOKUPS; ++i)
+        sink += traffic_find_near_free_spot(&vs[i], map, BENCH_SPOT_RADIUS) != NULL;
+    double t_index = now_sec() - t0;
+    (void)sink;
+
+    int mismatches = 0;
+    for (int i = 0; i < BENCH_SPOT_LOOKUPS; ++i)
+        mismatches += legacy_find_spot(&vs[i], map, BENCH_SPOT_RADIUS) !=
+                      traffic_find_near_free_spot(&vs[i], map, BENCH_SPOT_RADIUS);
+
+    printf("%-22s %2d spots %3d%% taken  scan %6.1f ns  index %6.1f ns  speedup %5.1fx  (%d mismatches)\n",
+           label, map->parking_count, taken_pct,
+           t_legacy * 1e9 / BENCH_SPOT_LOOKUPS, t_index * 1e9 / BENCH_SPOT_LOOKUPS,
+           t_index > 0 ? t_legacy / t_index : 0.0, mismatches);
+
+    for (int i = 0; i < map->parking_count; ++i)
+        map_release_spot(map, &map->parkings[i]);
+    free(vs);
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// traffic_step cost for n vehicles on a lot: half of them parked (asleep),
+// the others driving east/west paths longer than the run. Vehicles are
+// placed where their footprint fits and nobody else stands. Reports the
+// median tick, single slow ticks (page faults, preemption) aside.
+static void bench_tick(const char *label, Map *map, int n)
+{
+    VehiclePool pool;
+    vehicle_pool_init(&pool);
+    srand(BENCH_SEED);
+    int placed = 0, driving = 0;
+    for (int tries = 0; placed < n && tries < n * 1000; ++tries)
+    {
+        int x = rand() % map->width, y = rand() % map->height;
+        if (!map_rect_walkable(map, x, y, BENCH_CAR_W, BENCH_CAR_H))
+            continue;
+        int free = 1;
+        for (int dy = 0; dy < BENCH_CAR_H && free; ++dy)
+            for (int dx = 0; dx < BENCH_CAR_W && free; ++dx)
+                free = vehicle_pool_occupant(&pool, x + dx, y + dy) == NULL;
+        if (!free)
+            continue;
+
+        Vehicle tmp;
+        vehicle_init(&tmp, x, y, DIR_WEST);
+        Vehicle *v = vehicle_pool_spawn(&pool, &tmp);
+        if (!v)
+            break;
+        v->going_to_parking = 1; // keep them off the spot search
+        placed++;
+        if (placed % 2)
+        {
+            v->state = VEH_PARKED;
+            vehicle_pool_sync_occupancy(&pool, map);
+            vehicle_pool_sleep(&pool, v);
+            continue;
+        }
+        int gx = x + (rand() % 2 ? 2 : -2) * BENCH_TICKS;
+        if (gx < 0)
+            gx = 0;
+        if (gx >= map->width)
+            gx = map->width - 1;
+        const Path *p = path_find_with_size(map, x, y, gx, y, BENCH_CAR_W, BENCH_CAR_H);
+        if (p)
+        {
+            vehicle_set_path(v, p);
+            driving++;
+        }
+        vehicle_pool_sync_occupancy(&pool, map);
+    }
+
+    double ticks[BENCH_TICKS];
+    for (int t = 0; t < BENCH_TICKS; ++t)
+    {
+        double t0 = now_sec();
+        traffic_step(&pool, map, 0);
+        ticks[t] = now_sec() - t0;
+    }
+    qsort(ticks, BENCH_TICKS, sizeof(double), cmp_double);
+    double dt = ticks[BENCH_TICKS / 2];
+
+    printf("%-22s %5d vehicles (%4d driving)  %8.1f us/tick  %6.1f ns/vehicle\n",
+           label, placed, driving, dt * 1e6, placed ? dt * 1e9 / placed : 0.0);
+    vehicle_pool_free(&pool);
+}
+
+// Cost of bringing every precomputed flow field up to date after a gate
+// toggle: local repair vs rebuilding each field from scratch
+static void bench_gate_repair(const char *label, Map *map)
+{
+    map_add_footprint(map, 1, 1);
+    map_add_footprint(map, BENCH_CAR_W, BENCH_CAR_H);
+    double t[2];
+    int fields = 0;
+    for (int mode = 0; mode < 2; ++mode)
+    {
+        flow_fields_free();
+        flow_fields_set_incremental(mode == 1);
+        flow_fields_precompute(map, 1, 1);
+        flow_fields_precompute(map, BENCH_CAR_W, BENCH_CAR_H);
+        unsigned long repairs_before, rebuilds_before, repairs, rebuilds;
+        flow_fields_stats(&repairs_before, &rebuilds_before);
+        double t0 = now_sec();
+        for (int i = 0; i < BENCH_GATE_TOGGLES; ++i)
+        {
+            if (i % 2 == 0)
+                map_set_gate_open(map, !map_get_gate_open(map));
+            else
+                map_set_exit_gate_open(map, !map->gate_exit.open);
+            flow_fields_refresh(map);
+        }
+        t[mode] = now_sec() - t0;
+        flow_fields_stats(&repairs, &rebuilds);
+        fields = (int)(repairs + rebuilds - repairs_before - rebuilds_before) / BENCH_GATE_TOGGLES;
+    }
+    flow_fields_set_incremental(true);
+    flow_fields_free();
+
+    printf("%-22s %4d toggles  %3d fields  rebuild %8.3f ms/toggle  repair %8.3f ms/toggle  speedup %5.1fx\n",
+           label, BENCH_GATE_TOGGLES, fields, t[0] * 1000.0 / BENCH_GATE_TOGGLES,
+           t[1] * 1000.0 / BENCH_GATE_TOGGLES, t[1] > 0 ? t[0] / t[1] : 0.0);
+}
+
+int main(void)
+{
+    Map map;
+    if (!map_load(&map, "assets/map.txt"))
+    {
+        fprintf(stderr, "bench: run from the repository root\n");
+        return 1;
+    }
+    map_add_footprint(&map, BENCH_CAR_W, BENCH_CAR_H);
+    printf("== A* open list (footprint %dx%d) ==\n", BENCH_CAR_W, BENCH_CAR_H);
+    bench_astar("assets/map.txt", &map);
+    Map small = map;
+
+    char scaled[] = "/tmp/bench_map_XXXXXX";
+    int fd = mkstemp(scaled);
+    if (fd < 0)
+        return 1;
+    close(fd);
+    Map big;
+    int have_big = write_scaled_map("assets/map.txt", scaled, 2) && map_load(&big, scaled);
+    if (have_big)
+    {
+        map_add_footprint(&big, BENCH_CAR_W, BENCH_CAR_H);
+        bench_astar("map.txt scaled 4x", &big);
+    }
+
+    printf("\n== A* vs JPS (footprint %dx%d) ==\n", BENCH_CAR_W, BENCH_CAR_H);
+    bench_planners("assets/map.txt", &small);
+    if (have_big)
+        bench_planners("map.txt scaled 4x", &big);
+    static const int lots[][2] = {{20, 6}, {40, 12}};
+    for (size_t i = 0; i < sizeof(lots) / sizeof(lots[0]); ++i)
+    {
+        Map lot;
+        char label[32];
+        if (!write_generated_lot(scaled, lots[i][0], lots[i][1]) || !map_load(&lot, scaled))
+            continue;
+        map_add_footprint(&lot, BENCH_CAR_W, BENCH_CAR_H);
+        snprintf(label, sizeof(label), "lot %dx%d (%dx%d)", lots[i][0], lots[i][1], lot.width, lot.height);
+        bench_planners(label, &lot);
+        map_free(&lot);
+    }
+
+    printf("\n== Walkability tests ==\n");
+    bench_walkability("assets/map.txt", &small);
+    if (have_big)
+        bench_walkability("map.txt scaled 4x", &big);
+
+    printf("\n== Free parking spot lookup (radius %d) ==\n", BENCH_SPOT_RADIUS);
+    if (vehicle_sprites_init("assets/carSmall"))
+    {
+        static const int taken[] = {0, 50, 90, 100};
+        for (size_t i = 0; i < sizeof(taken) / sizeof(taken[0]); ++i)
+        {
+            bench_spot_lookup("assets/map.txt", &small, taken[i]);
+            if (have_big)
+                bench_spot_lookup("map.txt scaled 4x", &big, taken[i]);
+        }
+    }
+
+    printf("\n== Traffic tick vs vehicle count (median of %d ticks) ==\n", BENCH_TICKS);
+    Map lot;
+    if (write_generated_lot(scaled, 80, 40) && map_load(&lot, scaled))
+    {
+        static const int counts[] = {256, 1024, 4096, 16384};
+        for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i)
+            bench_tick("lot 80x40", &lot, counts[i]);
+        map_free(&lot);
+    }
+
+    printf("\n== Flow field refresh after a gate toggle ==\n");
+    bench_gate_repair("assets/map.txt", &small);
+    if (have_big)
+        bench_gate_repair("map.txt scaled 4x", &big);
+
+    if (have_big)
+        map_free(&big);
+    map_free(&small);
+    unlink(scaled);
+    return 0;
+}
@@ -0,0 +1,396 @@
+// Randomized self-checks of the vehicle pool against brute-force references.
+// Build and run with `make check` from the repository root.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/map/map.h"
+#include "../src/vehicle/vehicle_pool.h"
+#include "../src/vehicle/vehicle.h"
+
+#define CHECK_SEED 12345
+#define CHECK_OCC_STEPS 20000
+#define CHECK_OCC_VEHICLES 24
+#define CHECK_POOL_STEPS 30000
+#define CHECK_POOL_VEHICLES 200 // a few chunks' worth
+#define CHECK_POOL_DEAD_SAMPLES 8 // stale handles re-checked per step
+
+// Grids are small for the vehicle count so footprints overlap often
+// (shared tiles) and hang off the edges now and then (clipping)
+#define CHECK_MARGIN 4
+
+static Map g_small; // only their size is used by the occupancy grid
+static Map g_large;
+
+static int rand_range(int lo, int hi)
+{
+    return lo + rand() % (hi - lo + 1);
+}
+
+static void random_place(Vehicle *v, const Map *grid)
+{
+    v->x = rand_range(-CHECK_MARGIN, grid->width);
+    v->y = rand_range(-CHECK_MARGIN, grid->height);
+    v->dir = (Direction)(rand() % 4);
+}
+
+// Footprint each live vehicle should have stamped: awake vehicles where they
+// stand after a sync, sleepers where they went to sleep
+typedef struct
+{
+    const Sprite *spr;
+    int x, y;
+} Stamp;
+
+static Stamp g_slept[OCC_MAX_ID + 1]; // by id
+
+static void vehicle_sleep_recorded(VehiclePool *pool, Vehicle *v)
+{
+    vehicle_pool_sleep(pool, v);
+    g_slept[v->id] = (Stamp){vehicle_get_sprite(v), v->x, v->y};
+}
+
+// Compare the pool's grid with a rebuild from the expected stamps of the
+// live vehicles: a tile covered by one vehicle holds its id, one covered
+// by several is marked shared and names one of them. Returns the number
+// of shared tiles, -1 on a mismatch.
+static int check_grid(VehiclePool *pool, long step)
+{
+    int count;
+    Vehicle *const *live = vehicle_pool_live(pool, &count);
+    int width = pool->occ_width, height = pool->occ_height;
+    int *covering = calloc((size_t)width * height, sizeof(int));
+    bool *named = calloc((size_t)width * height, sizeof(bool));
+    int shared = -1;
+    if (!covering || !named)
+        goto done;
+    for (int i = 0; i < count; ++i)
+    {
+        const Vehicle *v = live[i];
+        Stamp st = vehicle_pool_is_asleep(v) ? g_slept[v->id] : (Stamp){vehicle_get_sprite(v), v->x, v->y};
+        if (v->occ_spr != st.spr || v->occ_x != st.x || v->occ_y != st.y)
+        {
+            printf("step %ld: vehicle %d stamped at (%d,%d)%s, expected (%d,%d)\n", step, v->id,
+                   v->occ_x, v->occ_y, v->occ_spr != st.spr ? " with another facing" : "", st.x, st.y);
+            goto done;
+        }
+        for (int c = 0; c < st.spr->cell_count; ++c)
+        {
+            int x = st.x + st.spr->cells[c].dx, y = st.y + st.spr->cells[c].dy;
+            if (x < 0 || y < 0 || x >= width || y >= height)
+                continue;
+            covering[y * width + x]++;
+            named[y * width + x] |= (pool->occ[y * width + x] & OCC_MAX_ID) == v->id;
+        }
+    }
+    shared = 0;
+    for (int i = 0; i < width * height; ++i)
+    {
+        uint16_t cell = pool->occ[i];
+        bool ok = covering[i] == 0 ? cell == 0
+                : covering[i] == 1 ? named[i] && !(cell & OCC_SHARED)
+                                   : named[i] && (cell & OCC_SHARED);
+        if (!ok)
+        {
+            printf("step %ld: tile (%d,%d) holds 0x%04x, covered by %d vehicles\n",
+                   step, i % width, i / width, cell, covering[i]);
+            shared = -1;
+            break;
+        }
+        shared += covering[i] > 1;
+    }
+done:
+    free(covering);
+    free(named);
+    return shared;
+}
+
+// Occupancy grid under random move/turn/sleep/wake/remove steps. Stamping
+// and erasing by footprint delta must stay symmetric, or tiles leak ids.
+static bool check_occupancy(void)
+{
+    VehiclePool pool;
+    vehicle_pool_init(&pool);
+    srand(CHECK_SEED);
+    long shared_steps = 0;
+    bool ok = true;
+
+    for (long step = 0; step < CHECK_OCC_STEPS && ok; ++step)
+    {
+        int count;
+        Vehicle *const *live = vehicle_pool_live(&pool, &count);
+        Vehicle *v = count ? live[rand() % count] : NULL;
+        int op = rand() % 10;
+        if (!v || (op == 0 && count < CHECK_OCC_VEHICLES))
+        {
+            Vehicle fresh;
+            vehicle_init(&fresh, 0, 0, DIR_EAST);
+            random_place(&fresh, &g_small);
+            if (!vehicle_pool_spawn(&pool, &fresh))
+            {
+                printf("step %ld: spawn failed\n", step);
+                ok = false;
+                break;
+            }
+        }
+        else if (op == 1)
+        {
+            vehicle_pool_despawn(&pool, v);
+        }
+        else if (op == 2 && !vehicle_pool_is_asleep(v))
+        {
+            vehicle_sleep_recorded(&pool, v);
+        }
+        else if (op == 3)
+        {
+            vehicle_pool_wake(&pool, v);
+        }
+        else if (!vehicle_pool_is_asleep(v))
+        {
+            // Mostly single steps as in traffic, sometimes a jump or a turn
+            if (op < 7)
+            {
+                v->x += rand_range(-1, 1);
+                v->y += rand_range(-1, 1);
+            }
+            else if (op < 9)
+                v->dir = (Direction)(rand() % 4);
+            else
+                random_place(v, &g_small);
+        }
+        if (!vehicle_pool_sync_occupancy(&pool, &g_small))
+        {
+            ok = false;
+            break;
+        }
+        int shared = check_grid(&pool, step);
+        ok = shared >= 0;
+        shared_steps += shared > 0;
+    }
+    printf("occupancy: %d steps, %ld with shared tiles: %s\n",
+           CHECK_OCC_STEPS, shared_steps, ok ? "ok" : "FAILED");
+    vehicle_pool_free(&pool);
+    return ok;
+}
+
+// What the pool should hold, in spawn order
+typedef struct
+{
+    Vehicle *vehicle; // must stay put while it lives
+    VehicleHandle handle;
+    int tag; // kept in the cold part, which must travel with it
+    bool asleep;
+} PoolRecord;
+
+typedef struct
+{
+    PoolRecord *live; // spawn order
+    int live_count;
+    VehicleHandle *dead; // handles of despawned vehicles, must not resolve
+    int dead_count;
+} PoolModel;
+
+static int model_find(const PoolModel *m, const Vehicle *v)
+{
+    for (int i = 0; i < m->live_count; ++i)
+        if (m->live[i].vehicle == v)
+            return i;
+    return -1;
+}
+
+static void model_despawn(PoolModel *m, VehiclePool *pool, Vehicle *v)
+{
+    int i = model_find(m, v);
+    m->dead[m->dead_count++] = m->live[i].handle;
+    memmove(&m->live[i], &m->live[i + 1], (m->live_count - i - 1) * sizeof(PoolRecord));
+    m->live_count--;
+    vehicle_pool_despawn(pool, v);
+}
+
+static void model_sleep(PoolModel *m, VehiclePool *pool, Vehicle *v)
+{
+    m->live[model_find(m, v)].asleep = true;
+    vehicle_sleep_recorded(pool, v);
+}
+
+// Live and active arrays, handles (stale ones included) and the per-slot
+// state against the model
+static bool check_pool_state(VehiclePool *pool, const PoolModel *m, long step)
+{
+    int count;
+    Vehicle *const *live = vehicle_pool_live(pool, &count);
+    if (count != m->live_count)
+    {
+        printf("step %ld: %d live vehicles, expected %d\n", step, count, m->live_count);
+        return false;
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        const PoolRecord *r = &m->live[i];
+        if (live[i] != r->vehicle)
+        {
+            printf("step %ld: live vehicle %d out of spawn order\n", step, i);
+            return false;
+        }
+        if (vehicle_pool_get(pool, r->handle) != r->vehicle || r->vehicle->id != r->handle.slot + 1 ||
+            r->vehicle->cold->parking_time_sec != r->tag || vehicle_pool_is_asleep(r->vehicle) != r->asleep)
+        {
+            printf("step %ld: vehicle with tag %d lost its slot, handle or state\n", step, r->tag);
+            return false;
+        }
+    }
+
+    Vehicle *const *active = vehicle_pool_active(pool, &count);
+    int expected = 0;
+    for (int i = 0; i < m->live_count; ++i)
+    {
+        if (m->live[i].asleep)
+            continue;
+        if (expected >= count || active[expected] != m->live[i].vehicle)
+        {
+            printf("step %ld: active set differs at %d (wrong member or order)\n", step, expected);
+            return false;
+        }
+        expected++;
+    }
+    if (expected != count)
+    {
+        printf("step %ld: %d active vehicles, expected %d\n", step, count, expected);
+        return false;
+    }
+
+    for (int i = 0; i < CHECK_POOL_DEAD_SAMPLES && m->dead_count; ++i)
+    {
+        if (vehicle_pool_get(pool, m->dead[rand() % m->dead_count]) != NULL)
+        {
+            printf("step %ld: stale handle resolves to a vehicle\n", step);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Slot map under random spawn/despawn/sleep/wake/move steps, including
+// despawning or putting to sleep the vehicle at hand while looping over
+// the live or active array (lazy compaction must keep those loops intact)
+static bool check_pool(void)
+{
+    VehiclePool pool;
+    vehicle_pool_init(&pool);
+    srand(CHECK_SEED);
+    PoolModel m = {0};
+    m.live = malloc(CHECK_POOL_VEHICLES * sizeof(PoolRecord));
+    m.dead = malloc(CHECK_POOL_STEPS * sizeof(VehicleHandle));
+    Vehicle **seen = malloc(CHECK_POOL_VEHICLES * sizeof(Vehicle *));
+    int tag = 0;
+    bool ok = m.live && m.dead && seen;
+
+    for (long step = 0; step < CHECK_POOL_STEPS && ok; ++step)
+    {
+        int pick = m.live_count ? rand() % m.live_count : -1;
+        Vehicle *v = pick >= 0 ? m.live[pick].vehicle : NULL;
+        int op = rand() % 12;
+        // Grow towards the cap and drain again every few thousand steps, so
+        // chunks fill, empty and their slots get reused
+        bool grow = (step / 3000) % 2 == 0;
+        if (!v || (op < (grow ? 5 : 1) && m.live_count < CHECK_POOL_VEHICLES))
+        {
+            // Sometimes in place of another one: its slot is reused while
+            // it still sits in the arrays
+            if (v && op == 0)
+                model_despawn(&m, &pool, v);
+            Vehicle fresh;
+            vehicle_init(&fresh, 0, 0, DIR_EAST);
+            random_place(&fresh, &g_large);
+            VehicleCold cold;
+            vehicle_cold_init(&cold);
+            cold.parking_time_sec = ++tag;
+            fresh.cold = &cold;
+            Vehicle *nv = vehicle_pool_spawn(&pool, &fresh);
+            if (!nv)
+            {
+                printf("step %ld: spawn failed\n", step);
+                ok = false;
+                break;
+            }
+            m.live[m.live_count++] = (PoolRecord){nv, vehicle_pool_handle(&pool, nv), tag, false};
+        }
+        else if (op < (grow ? 6 : 5))
+        {
+            model_despawn(&m, &pool, v);
+        }
+        else if (op == 7 && !m.live[pick].asleep)
+        {
+            model_sleep(&m, &pool, v);
+        }
+        else if (op == 8 && m.live[pick].asleep)
+        {
+            m.live[pick].asleep = false;
+            vehicle_pool_wake(&pool, v);
+        }
+        else if (op == 9 || op == 10)
+        {
+            // Loop over the active (or live) array, dropping some vehicles
+            // on the way as the sim's removal and parking passes do
+            int count;
+            Vehicle *const *arr = op == 9 ? vehicle_pool_active(&pool, &count) : vehicle_pool_live(&pool, &count);
+            memcpy(seen, arr, count * sizeof(Vehicle *));
+            for (int i = 0; i < count && ok; ++i)
+            {
+                if (arr[i] != seen[i])
+                {
+                    printf("step %ld: array changed under a loop at %d\n", step, i);
+                    ok = false;
+                }
+                int r = rand() % 128;
+                if (r == 0)
+                    model_despawn(&m, &pool, arr[i]);
+                else if (r == 1 && !vehicle_pool_is_asleep(arr[i]))
+                    model_sleep(&m, &pool, arr[i]);
+            }
+        }
+        else if (!m.live[pick].asleep)
+        {
+            v->x += rand_range(-1, 1);
+            v->y += rand_range(-1, 1);
+            if (op == 11)
+                v->dir = (Direction)(rand() % 4);
+        }
+        if (!ok)
+            break;
+        if (!vehicle_pool_sync_occupancy(&pool, &g_large))
+        {
+            ok = false;
+            break;
+        }
+        ok = check_pool_state(&pool, &m, step) && check_grid(&pool, step) >= 0;
+    }
+
+    // Every stale handle, once more at the end
+    for (int i = 0; i < m.dead_count && ok; ++i)
+        ok = vehicle_pool_get(&pool, m.dead[i]) == NULL;
+    printf("pool: %d steps, %d spawned, %d chunks: %s\n",
+           CHECK_POOL_STEPS, tag, pool.chunk_count, ok ? "ok" : "FAILED");
+    vehicle_pool_free(&pool);
+    free(m.live);
+    free(m.dead);
+    free(seen);
+    return ok;
+}
+
+int main(void)
+{
+    if (!vehicle_sprites_init("assets/carSmall"))
+    {
+        fprintf(stderr, "check: run from the repository root\n");
+        return 1;
+    }
+    g_small.width = 32;
+    g_small.height = 16;
+    g_large.width = 96;
+    g_large.height = 48;
+
+    bool ok = check_occupancy();
+    ok = check_pool() && ok;
+    return ok ? 0 : 1;
+}